@@ -5,8 +5,11 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include "HashADT.h"
 #include "realloc.h"
+#include "memtrack.h"
 
 struct hashtab_s
 {
@@ -20,12 +23,154 @@ struct hashtab_s
   bool (*equals)(const void *key1, const void *key2);
   void (*print)(const void *key, const void *value);
   void (*delete)(void *key, void *value);
+  bool filtered;     //true when the client asked for the filter
+  uint64_t *filter;     //blocks of FILTER_WORDS words, NULL until a key is added
+  size_t filter_blocks;     //number of blocks in filter
+  size_t filter_stale;     //keys removed since filter was built
 };
 
+//64-bit words in a filter block, one cache line
+#define FILTER_WORDS 8
+
+//table slots per filter block, giving the filter 16 bits per slot
+#define SLOTS_PER_BLOCK 32
+
+//multipliers picking the bit a key sets in each word of its block
+static const uint32_t filter_salts[FILTER_WORDS] = {
+  0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+  0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+/**
+Spreads the bits of a client hash, which may be weak in the high bits
+@param hash: the hash from the client hash function
+@return the mixed hash
+**/
+static uint64_t mix_hash(size_t hash)
+{
+  uint64_t mixed = (uint64_t)hash;
+  mixed^=mixed >> 33;
+  mixed*=0xff51afd7ed558ccdULL;
+  mixed^=mixed >> 33;
+  mixed*=0xc4ceb9fe1a85ec53ULL;
+  mixed^=mixed >> 33;
+  return(mixed);
+}
+
+/**
+Finds the filter block of a key
+@param t: the table
+@param mixed: the mixed hash of the key
+@return the first word of the block
+**/
+static uint64_t *filter_block(const HashADT t, uint64_t mixed)
+{
+  uint64_t block = ((mixed >> 32) * (uint64_t)t->filter_blocks) >> 32;
+  return(t->filter + block * FILTER_WORDS);
+}
+
+/**
+Sets the bits of a key in the filter, one in each word of its block
+@param t: the table
+@param hash: the hash of the key from the client hash function
+**/
+static void filter_add(HashADT t, size_t hash)
+{
+  uint64_t mixed = mix_hash(hash);
+  uint64_t *block = filter_block(t, mixed);
+  for(size_t i = 0; i < FILTER_WORDS; i++)
+  {
+    block[i]|=1ULL << (((uint32_t)mixed * filter_salts[i]) >> 26);
+  }
+}
+
+/**
+Tells whether a key may be in the table
+@param t: the table
+@param hash: the hash of the key from the client hash function
+@return false if the key is surely not in the table
+**/
+static bool filter_has(const HashADT t, size_t hash)
+{
+  uint64_t mixed = mix_hash(hash);
+  const uint64_t *block = filter_block(t, mixed);
+  uint64_t found = 1;
+  for(size_t i = 0; i < FILTER_WORDS; i++)
+  {
+    found&=block[i] >> (((uint32_t)mixed * filter_salts[i]) >> 26);
+  }
+  return((found & 1) == 1);
+}
+
+/**
+Builds the filter again from the keys, sized for the current capacity
+@param t: the table
+**/
+static void filter_build(HashADT t)
+{
+  size_t blocks = t->capacity / SLOTS_PER_BLOCK;
+  if(blocks == 0)
+  {
+    blocks = 1;
+  }
+  if(blocks != t->filter_blocks)
+  {
+    mem_free(MEM_TABLE, t->filter);
+    t->filter = mem_aligned(MEM_TABLE, sizeof(uint64_t) * FILTER_WORDS, sizeof(uint64_t) * FILTER_WORDS * blocks);
+    assert(t->filter != NULL);
+    t->filter_blocks = blocks;
+  }
+  memset(t->filter, 0, sizeof(uint64_t) * FILTER_WORDS * blocks);
+  for(size_t i = 0; i < t->capacity; i++)
+  {
+    if(t->keys[i] != NULL)
+    {
+      filter_add(t, t->hash(t->keys[i]));
+    }
+  }
+  t->filter_stale = 0;
+}
+
+void ht_use_filter( HashADT t, bool on )
+{
+  t->filtered = on;
+  if(on == false)
+  {
+    mem_free(MEM_TABLE, t->filter);
+    t->filter = NULL;
+    t->filter_blocks = 0;
+  }
+  else if(t->keys != 0 && t->filter == NULL)
+  {
+    filter_build(t);
+  }
+}
+
+//called as tables start and finish each stage, NULL when nobody is watching
+static void (*stage_observer)(ht_stage_t stage, bool starting) = NULL;
+
+/**
+Tells the observer, if there is one, that a stage starts or ends
+@param stage: the stage
+@param starting: true as it starts, false as it ends
+**/
+static void notify(ht_stage_t stage, bool starting)
+{
+  if(stage_observer != NULL)
+  {
+    stage_observer(stage, starting);
+  }
+}
+
+void ht_observe( void (*observer)( ht_stage_t stage, bool starting ) )
+{
+  stage_observer = observer;
+}
+
 HashADT ht_create(size_t (*hash)( const void *key ), bool (*equals)( const void *key1, const void *key2 ), 
                   void (*print)( const void *key, const void *value ), void (*delete)( void *key, void *value ))
 {
-  HashADT t = (HashADT) malloc(sizeof(struct hashtab_s));
+  HashADT t = (HashADT) mem_malloc(MEM_TABLE, sizeof(struct hashtab_s));
   t->keys = 0;
   t->values = 0;
   t->size = 0;
@@ -36,6 +181,10 @@ HashADT ht_create(size_t (*hash)( const void *key ), bool (*equals)( const void
   t->equals = equals;
   t->print = print;
   t->delete = delete;
+  t->filtered = false;
+  t->filter = NULL;
+  t->filter_blocks = 0;
+  t->filter_stale = 0;
   return (t);
 }
 
@@ -52,9 +201,10 @@ void ht_destroy( HashADT t )
       }
     }
   }
-  free(t->keys);
-  free(t->values);
-  free(t);
+  mem_free(MEM_TABLE, t->keys);
+  mem_free(MEM_TABLE, t->values);
+  mem_free(MEM_TABLE, t->filter);
+  mem_free(MEM_TABLE, t);
 }
 
 void ht_dump( const HashADT t, bool contents )
@@ -88,7 +238,18 @@ void ht_dump( const HashADT t, bool contents )
   }
 }
 
-const void *ht_get( const HashADT t, const void *key )
+size_t ht_rehashes( const HashADT t )
+{
+  return(t->rehashes);
+}
+
+/**
+Finds the value of a key that is in the table
+@param t: the table
+@param key: the key
+@return the value
+**/
+static const void *probe_get( const HashADT t, const void *key )
 {
   size_t hash_value = t->hash(key) % (int)t->capacity;
   while(true)
@@ -113,9 +274,28 @@ const void *ht_get( const HashADT t, const void *key )
   }
 }
 
-bool ht_has( const HashADT t, const void *key )
+const void *ht_get( const HashADT t, const void *key )
 {
-  size_t hash_value = t->hash(key) % t->capacity;
+  notify(HT_PROBE, true);
+  const void *value = probe_get(t, key);
+  notify(HT_PROBE, false);
+  return(value);
+}
+
+/**
+Checks if the table has a key
+@param t: the table
+@param key: the key
+@return true if the key is in the table
+**/
+static bool probe_has( const HashADT t, const void *key )
+{
+  size_t hash = t->hash(key);
+  if(t->filter != NULL && filter_has(t, hash) == false)
+  {
+    return(false);
+  }
+  size_t hash_value = hash % t->capacity;
   size_t counter = 0;
   while(counter < t->capacity)
   {
@@ -142,16 +322,33 @@ bool ht_has( const HashADT t, const void *key )
   return(false);
 }
 
-void *ht_put( HashADT t, const void *key, const void *value )
+bool ht_has( const HashADT t, const void *key )
+{
+  notify(HT_PROBE, true);
+  bool found = probe_has(t, key);
+  notify(HT_PROBE, false);
+  return(found);
+}
+
+/**
+Adds a key value pair or updates the value of a key, growing the table
+once it is too full
+@param t: the table
+@param key: the key
+@param value: the value
+@return the old value of the key, or NULL if it is new
+**/
+static void *probe_put( HashADT t, const void *key, const void *value )
 {
   if( t->keys == 0 && t->values == 0) 
   {
-		t->keys = calloc(t->capacity, sizeof(void *) * t->capacity );
-    t->values = calloc(t->capacity, sizeof(void *) * t->capacity );
+		t->keys = mem_calloc(MEM_TABLE, t->capacity, sizeof(void *) );
+    t->values = mem_calloc(MEM_TABLE, t->capacity, sizeof(void *) );
 		assert(t->keys != 0);
     assert(t->values != 0);
 	}
-  size_t hash_value = t->hash(key) % t->capacity;
+  size_t hash = t->hash(key);
+  size_t hash_value = hash % t->capacity;
   while(true)
   {
     if(t->keys[hash_value] == NULL)
@@ -162,8 +359,24 @@ void *ht_put( HashADT t, const void *key, const void *value )
       float rehash = (float)t->size / (float)t->capacity;
       if (rehash >= LOAD_THRESHOLD)
       {
+        notify(HT_PROBE, false);
+        notify(HT_RESIZE, true);
         realloc_hash_table(t);
         t->rehashes+=1;
+        if(t->filtered == true)
+        {
+          filter_build(t);
+        }
+        notify(HT_RESIZE, false);
+        notify(HT_PROBE, true);
+      }
+      else if(t->filtered == true && t->filter == NULL)
+      {
+        filter_build(t);
+      }
+      else if(t->filtered == true)
+      {
+        filter_add(t, hash);
       }
       return(NULL);
     }
@@ -185,6 +398,93 @@ void *ht_put( HashADT t, const void *key, const void *value )
   }
 }
 
+void *ht_put( HashADT t, const void *key, const void *value )
+{
+  notify(HT_PROBE, true);
+  void *old_value = probe_put(t, key, value);
+  notify(HT_PROBE, false);
+  return(old_value);
+}
+
+/**
+Takes a key out of the table, shifting back the entries after it
+@param t: the table
+@param key: the key
+@return the value of the key, or NULL if it was not in the table
+**/
+static void *probe_remove( HashADT t, const void *key )
+{
+  if(t->keys == 0)
+  {
+    return(NULL);
+  }
+  size_t hash_value = t->hash(key) % t->capacity;
+  size_t counter = 0;
+  while(t->keys[hash_value] != NULL && t->equals(t->keys[hash_value], key) == false)
+  {
+    hash_value+=1;
+    if(hash_value >= t->capacity)
+    {
+      hash_value = 0;
+    }
+    counter+=1;
+    if(counter >= t->capacity)
+    {
+      return(NULL);
+    }
+  }
+  if(t->keys[hash_value] == NULL)
+  {
+    return(NULL);
+  }
+  void* old_value = t->values[hash_value];
+  size_t hole = hash_value;
+  size_t next = hole + 1 >= t->capacity ? 0 : hole + 1;
+  while(t->keys[next] != NULL)
+  {
+    size_t home = t->hash(t->keys[next]) % t->capacity;
+    // an entry may fill the hole only if its home is not after the hole
+    // in the run, walking from home to next wrapping around
+    bool movable;
+    if(hole <= next)
+    {
+      movable = home <= hole || home > next;
+    }
+    else
+    {
+      movable = home <= hole && home > next;
+    }
+    if(movable == true)
+    {
+      t->keys[hole] = t->keys[next];
+      t->values[hole] = t->values[next];
+      hole = next;
+    }
+    next = next + 1 >= t->capacity ? 0 : next + 1;
+  }
+  t->keys[hole] = NULL;
+  t->values[hole] = NULL;
+  t->size-=1;
+  if(t->filter != NULL)
+  {
+    // a Bloom filter cannot forget a key, so start over once enough are stale
+    t->filter_stale+=1;
+    if(t->filter_stale * 2 > t->size)
+    {
+      filter_build(t);
+    }
+  }
+  return(old_value);
+}
+
+void *ht_remove( HashADT t, const void *key )
+{
+  notify(HT_PROBE, true);
+  void *old_value = probe_remove(t, key);
+  notify(HT_PROBE, false);
+  return(old_value);
+}
+
 void **ht_keys( const HashADT t )
 {
   if(t->keys == 0)
@@ -217,9 +517,11 @@ void **ht_values( const HashADT t )
   {
     void **values_copy = (void **) calloc(t->size, sizeof(void *));
     int index = 0;
+    // walk the occupied slots like ht_keys, so a NULL value keeps the two
+    // collections in step
     for(size_t i = 0; i < t->capacity; i++)
     {
-      if(t->values[i] != NULL)
+      if(t->keys[i] != NULL)
       {
         values_copy[index] = t->values[i];
         index+=1;
@@ -234,11 +536,11 @@ void realloc_hash_table(HashADT t)
   size_t new_size = t->capacity * RESIZE_FACTOR;
   void** old_key_indexs = ht_keys(t);
   void** old_value_indexs = ht_values(t);
-  free(t->keys);
-  free(t->values);
+  mem_free(MEM_TABLE, t->keys);
+  mem_free(MEM_TABLE, t->values);
   t->capacity = new_size; 
-  t->keys = calloc(new_size, sizeof(void *));
-  t->values = calloc(new_size, sizeof(void *));
+  t->keys = mem_calloc(MEM_TABLE, new_size, sizeof(void *));
+  t->values = mem_calloc(MEM_TABLE, new_size, sizeof(void *));
   for(size_t i = 0; i < t->size; i++)
   {
     size_t hash_value = t->hash(old_key_indexs[i]) % t->capacity;
@@ -32,7 +32,9 @@
 ///   delete function, which causes the delete function to NOT free the
 ///   (key, value) pair.
 ///
-/// - There is no remove functionality. Entries remain until you call destroy.
+/// - Entries remain until they are removed or you call destroy.  Removing
+///   an entry hands its (key,value) pair back to the client, the delete
+///   function is not called on it.
 ///
 /// - The destroy calls a no-operation delete if the client passes NULL destroy.
 ///
@@ -95,6 +97,43 @@ void ht_destroy( HashADT t );
 /// 
 void ht_dump( const HashADT t, bool contents );
 
+///
+/// Get the number of times the table has grown since it was created.
+///
+/// @param t The table
+///
+/// @return The number of rehashes
+///
+size_t ht_rehashes( const HashADT t );
+
+///
+/// Keep a blocked Bloom filter of the keys in front of ht_has, so most
+/// keys that are not in the table are turned away after reading one cache
+/// line instead of probing a run of occupied slots.  The filter takes two
+/// bytes per slot.  Removed keys stay in it until it is rebuilt, which
+/// happens when the table grows or once removals reach half the size.
+///
+/// @param t The table
+/// @param on true to keep the filter, false to drop it
+///
+void ht_use_filter( HashADT t, bool on );
+
+///
+/// The parts of a table operation an observer is told about: looking for
+/// the slot of a key, and growing the table.
+///
+typedef enum { HT_PROBE, HT_RESIZE } ht_stage_t;
+
+///
+/// Install a function that every table calls as it starts and finishes a
+/// stage, so a profiler can attribute costs to it.  Stages never nest;
+/// a put that grows the table finishes its probe before the resize starts.
+///
+/// @param observer Called with the stage, and true as it starts or false
+///        as it ends.  NULL removes the observer.
+///
+void ht_observe( void (*observer)( ht_stage_t stage, bool starting ) );
+
 ///
 /// Get the value associated with a key from the table.  This function
 /// uses the registered hash function to locate the key, and the
@@ -139,6 +178,21 @@ bool ht_has( const HashADT t, const void *key );
 ///
 void *ht_put( HashADT t, const void *key, const void *value );
 
+///
+/// Remove a key and its value from the table.  The entries after it in the
+/// same probe run are shifted back, so lookups never stop early at the
+/// hole it leaves.  This function uses the registered hash function to
+/// locate the key, and the registered equals function to check for equality.
+/// 
+/// @param t The table
+/// @param key The key
+/// 
+/// @post the client owns the removed key and value again.
+/// 
+/// @return The value associated with the key, or NULL if there was none.
+///
+void *ht_remove( HashADT t, const void *key );
+
 ///
 /// Get the collection of keys from the table.  This function allocates
 /// space to store the keys, which the caller is responsible for freeing.
@@ -152,8 +206,9 @@ void *ht_put( HashADT t, const void *key, const void *value );
 void **ht_keys( const HashADT t );
 
 ///
-/// Get the collection of values from the table.  This function allocates
-/// space to store the values, which the caller is responsible for freeing.
+/// Get the collection of values from the table, in the same order as
+/// ht_keys, NULL values included.  This function allocates space to store
+/// the values, which the caller is responsible for freeing.
 /// 
 /// @param t The table
 /// 
@@ -7,10 +7,29 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
 #include "HashADT.h"
+#include "intersect.h"
+#include "csr.h"
+#include "trie.h"
+#include "varint.h"
+#include "histogram.h"
+#include "perfcount.h"
+#include "memtrack.h"
+#include "image.h"
+#include "parallel.h"
 
 //keeps track of the amount of people in the hash table
 size_t size_of_hashtable = 0;
+//keeps track of the amount of friendships between people
+size_t total_friendships = 0;
+//bumped by every change to the people or friendships, so caches built from
+//the graph can tell they are stale
+size_t graph_version = 0;
 
 /// str_hash function returns the hash of a native C-string.
 /// @param element the c-string to hash
@@ -33,587 +52,4835 @@ static size_t str_hash( const void *element ) {
 static bool str_equals( const void *element1, const void *element2 ) {
     return strcmp( (char*)element1, (char*)element2 ) == 0;
 }
-typedef struct person_s {
-    char *name;     //name of the person      
-    char *handle;     //handle of the person
-    struct person_s **friends;     //dynamic collection of friends
-    size_t friend_count;     //current number of friends
-    size_t max_friends;     //current limit on friends      
-} person_t;
 
 /**
-Adds a person to the hashtable where the key is the handle and the struct is the value
+Creates the table from the handle of each person to their id, with the
+filter in front of it since many commands name handles nobody has
+@return the empty table
+**/
+static HashADT create_people_table(void)
+{
+  HashADT hashtable = ht_create(str_hash, str_equals, NULL, NULL);
+  ht_use_filter(hashtable, true);
+  return(hashtable);
+}
+
+/// The print output kept for a person by the print cache, allocated only
+/// while the person is cached
+typedef struct rendered_s {
+    uint32_t id;     //the id of the person printed
+    struct rendered_s *prev;     //entry printed more recently
+    struct rendered_s *next;     //entry printed less recently
+    size_t length;     //bytes of text
+    uint32_t version;     //friends version of the person when text was made
+    char text[];     //the output of print for the person
+} rendered_t;
+
+//true when friends are kept as compressed sorted ids instead of arrays of
+//pointers, set by the -c command line flag
+bool compressed_adjacency = false;
+
+//true when the commands of the data file are run a window at a time, with
+//friend and unfriend commands on different people applied in parallel, set
+//by the -b command line flag
+bool batch_mode = false;
+
+//the published image print, size and stats read from when running as a
+//read replica, set by the -r command line flag
+image_reader_t replica = NULL;
+
+//the number of friends added to a compressed person before they are merged
+//into the packed ids
+#define TAIL_LIMIT 16
+
+//marks the end of a list of people linked by id, and an id nobody has
+#define NO_PERSON ((uint32_t)-1)
+
+/// Walks the friends of a person whichever way they are stored
+typedef struct friend_iter_s {
+    uint32_t id;     //the person whose friends are walked
+    size_t slot;     //next position in the friends array or the tail
+    const uint8_t *cursor;     //next coded byte of packed
+    size_t decoded;     //number of ids read from packed
+    uint32_t last;     //the last id read from packed
+} friend_iter_t;
+
+/// A buffer the sorted friend ids of a compressed person are decoded into,
+/// reused from one person to the next and freed by whoever owns it
+typedef struct id_buffer_s {
+    uint32_t *ids;     //the decoded ids
+    size_t capacity;     //the length of ids
+} id_buffer_t;
+
+//marks an empty slot of a friends array
+#define NO_FRIEND ((uint32_t)-1)
+
+/// A frozen view of the people and their friends taken by the snapshot
+/// command, indexed by id. Friends arrays are shared with the live people
+/// until a writer changes one, at which point the writer copies it first
+/// (copy-on-write).
+typedef struct snapshot_s {
+    size_t people;     //number of people captured
+    size_t ids;     //ids handed out when it was taken, the length of the arrays
+    size_t *offsets;     //where each friends array started in adjacency
+    uint8_t **packed;     //packed friend ids at the time, in compressed mode
+    size_t *friend_counts;     //friend counts at the time of the snapshot
+    size_t *max_friends;     //friend array lengths at the time of the snapshot
+    char **names;     //names of the people removed since, NULL for the rest
+    char **handles;     //handles of the people removed since, NULL for the rest
+} snapshot_t;
+
+//the snapshot queries run against, NULL when none has been taken
+snapshot_t* live_snapshot = NULL;
+
+//first and last names of everyone, to the id of the person
+TrieADT name_index = NULL;
+
+//the number of matches find prints when none is given
+#define FIND_LIMIT 10
+
+//the person store. Every person is a dense id, and each of their fields is
+//an array indexed by id, so a walk over many people reads only the arrays
+//of the fields it needs, one after the other. The hashtable maps a handle
+//to the id. Ids are never reused, the fields of a removed person are
+//cleared and a NULL handle marks the id as unused
+
+//the number of ids handed out so far
+size_t people_count = 0;
+//the current length of the arrays by id
+size_t people_capacity = 0;
+
+//the name of every person by id, "first last"
+char** names_by_id = NULL;
+//the handle of every person by id, also the key of the hashtable
+char** handles_by_id = NULL;
+//the friend count of every person by id
+size_t* friend_counts_by_id = NULL;
+//the length of the friends array of every person by id
+size_t* max_friends_by_id = NULL;
+//where the friends array of every person by id starts in adjacency
+size_t* offsets_by_id = NULL;
+//bumped whenever the friends of a person or their order change
+uint32_t* versions_by_id = NULL;
+//true while the friends of a person are still referenced by the live snapshot
+bool* shared_by_id = NULL;
+//the previous and next person with the same friend count, NO_PERSON at the
+//ends of the list
+uint32_t* degree_prev_by_id = NULL;
+uint32_t* degree_next_by_id = NULL;
+//the ids of the friends of every person in increasing order, built by
+//sorted_friend_ids in array mode, and whether they match the friends array
+uint32_t** sorted_by_id = NULL;
+bool* sorted_valid_by_id = NULL;
+//the print cache entry of every person, NULL when not cached
+rendered_t** rendered_by_id = NULL;
+//the friend ids of every person coded by varint_encode, in compressed mode
+uint8_t** packed_by_id = NULL;
+//the number of ids in packed_by_id
+size_t* packed_counts_by_id = NULL;
+//friend ids added since packed was last rebuilt, NULL when none
+uint32_t** tails_by_id = NULL;
+//the number of ids in tails_by_id
+size_t* tail_counts_by_id = NULL;
+
+//the friends arrays of all people, each a run of max_friends_by_id ids at
+//offsets_by_id with NO_FRIEND in the empty slots, in array mode
+uint32_t* adjacency = NULL;
+//where each person sits in the friends array of the friend in the same
+//position of adjacency
+uint32_t* adjacency_slots = NULL;
+//the number of entries of adjacency handed out to friends arrays
+size_t adjacency_length = 0;
+//the current length of adjacency and adjacency_slots
+size_t adjacency_capacity = 0;
+//entries of adjacency in friends arrays that were moved or removed, which
+//compacting gives back
+size_t adjacency_garbage = 0;
+
+//union-find parent of each id, a root is its own parent
+uint32_t* component_parent = NULL;
+//union-find rank of each root, an upper bound on its tree height
+uint8_t* component_rank = NULL;
+//the number of connected groups of people, once dirty_pairs are applied
+size_t component_count = 0;
+//pairs of ids unfriended since the components were last refreshed
+uint32_t* dirty_pairs = NULL;
+//the number of ids in dirty_pairs, two per unfriending
+size_t dirty_length = 0;
+//the current length of dirty_pairs
+size_t dirty_capacity = 0;
+
+/**
+Finds the root of the group an id belongs to, pointing every id on the way
+directly at the root (path compression)
+@param id: the id to look up
+@return the id of the root of its group
+**/
+static uint32_t find_component(uint32_t id)
+{
+  uint32_t root = id;
+  while(component_parent[root] != root)
+  {
+    root = component_parent[root];
+  }
+  while(component_parent[id] != root)
+  {
+    uint32_t next = component_parent[id];
+    component_parent[id] = root;
+    id = next;
+  }
+  return(root);
+}
+
+/**
+Joins the groups of two ids, hanging the shallower tree under the deeper one
+(union by rank)
+@param id1: an id in the first group
+@param id2: an id in the second group
+**/
+static void join_components(uint32_t id1, uint32_t id2)
+{
+  uint32_t root1 = find_component(id1);
+  uint32_t root2 = find_component(id2);
+  if(root1 == root2)
+  {
+    return;
+  }
+  if(component_rank[root1] < component_rank[root2])
+  {
+    component_parent[root1] = root2;
+  }
+  else if(component_rank[root1] > component_rank[root2])
+  {
+    component_parent[root2] = root1;
+  }
+  else
+  {
+    component_parent[root2] = root1;
+    component_rank[root1]+=1;
+  }
+  component_count-=1;
+}
+
+/**
+Remembers that two friends were unfriended, so their group may have split
+@param id1: the id of one of the people
+@param id2: the id of the other person
+**/
+static void mark_component_dirty(uint32_t id1, uint32_t id2)
+{
+  if(dirty_length + 2 > dirty_capacity)
+  {
+    dirty_capacity = dirty_capacity == 0 ? 16 : dirty_capacity * 2;
+    dirty_pairs = mem_realloc(MEM_INDEXES, dirty_pairs, sizeof(uint32_t) * dirty_capacity);
+    assert(dirty_pairs != NULL);
+  }
+  dirty_pairs[dirty_length] = id1;
+  dirty_pairs[dirty_length + 1] = id2;
+  dirty_length+=2;
+}
+
+//mutual friend counts indexed by id, all zero between suggest queries
+uint32_t* suggest_counts = NULL;
+//ids whose suggest_counts entry was raised by the current query
+uint32_t* suggest_touched = NULL;
+//the current length of suggest_counts and suggest_touched
+size_t suggest_capacity = 0;
+
+//friends of friends a suggest query must walk before the walk is split
+//across the parallel workers, below it waking them costs more than it saves
+#define SUGGEST_PARALLEL_MIN (1 << 14)
+
+/// The friends of friends counted by one suggest worker
+typedef struct suggest_shard_s {
+    uint32_t *counts;     //mutual friend counts indexed by id, all zero between queries
+    uint32_t *touched;     //ids whose counts entry was raised by the current query
+    size_t touched_length;     //number of ids in touched
+    size_t capacity;     //the length of counts and touched
+} suggest_shard_t;
+
+//the counts of each suggest worker. Worker 0 counts straight into
+//suggest_counts and suggest_touched, the others into arrays of their own
+//that are merged into those once the walk is done
+suggest_shard_t suggest_shards[MAX_THREADS];
+
+//the last round of the running batch each id is changed in, 0 for none
+uint32_t* batch_rounds = NULL;
+//the current length of batch_rounds
+size_t batch_capacity = 0;
+
+//the graph oriented from lower to higher degree, indexed by degree rank
+csr_t* forward_graph = NULL;
+//the graph_version forward_graph and triangle_count were built at
+size_t forward_version = 0;
+//the number of triangles in forward_graph
+uint64_t triangle_count = 0;
+
+//the graph with people numbered by decreasing friend count, so the most
+//linked people share cache lines, used by rank
+csr_t* rank_graph = NULL;
+//the id of the person at each position of rank_graph
+uint32_t* rank_order = NULL;
+//the PageRank of the person at each position of rank_graph
+double* page_rank = NULL;
+//the graph_version rank_graph and page_rank were built at
+size_t rank_version = 0;
+//the tolerance page_rank was converged to
+double rank_tolerance = 0.0;
+
+//the probability of following a friendship in PageRank
+#define RANK_DAMPING 0.85
+//the tolerance used by rank when none is given
+#define RANK_TOLERANCE 1e-6
+//the most PageRank iterations rank will run
+#define RANK_MAX_ITERATIONS 100
+
+//marks an id that was reached from nowhere, the start of a search
+#define NO_PARENT ((uint32_t)-1)
+
+//a level is expanded bottom-up once its friend count passes the friend
+//count not yet reached divided by this
+#define BOTTOM_UP_DIVISOR 14
+
+/// One side of the bidirectional breadth first search used by path
+typedef struct search_side_s {
+    uint64_t *visited;     //bitmap of the ids reached from this side
+    uint32_t *parent;     //id each reached person was reached from
+    uint32_t *frontier;     //ids reached by the last expanded level
+    size_t frontier_length;     //number of ids in frontier
+    uint32_t *next;     //ids reached by the level being expanded
+    size_t next_length;     //number of ids in next
+    size_t frontier_friends;     //total friend count of the frontier
+    size_t unexplored_friends;     //total friend count of ids not yet reached
+} search_side_t;
+
+//the people with each friend count, as doubly linked lists by id through
+//degree_prev_by_id and degree_next_by_id, most recently changed first
+uint32_t* degree_buckets = NULL;
+//the current length of degree_buckets
+size_t degree_capacity = 0;
+//the highest friend count of anyone, the first non-empty bucket from the top
+size_t max_degree = 0;
+
+/**
+Puts a person at the front of the bucket for a friend count
+@param id: the id of the person to link
+@param degree: the friend count of the bucket
+**/
+static void place_degree(uint32_t id, size_t degree)
+{
+  if(degree >= degree_capacity)
+  {
+    size_t old_capacity = degree_capacity;
+    degree_capacity = degree_capacity == 0 ? 16 : degree_capacity * 2;
+    degree_buckets = mem_realloc(MEM_INDEXES, degree_buckets, sizeof(uint32_t) * degree_capacity);
+    assert(degree_buckets != NULL);
+    memset(degree_buckets + old_capacity, 0xff, sizeof(uint32_t) * (degree_capacity - old_capacity));
+  }
+  degree_prev_by_id[id] = NO_PERSON;
+  degree_next_by_id[id] = degree_buckets[degree];
+  if(degree_buckets[degree] != NO_PERSON)
+  {
+    degree_prev_by_id[degree_buckets[degree]] = id;
+  }
+  degree_buckets[degree] = id;
+  if(degree > max_degree)
+  {
+    max_degree = degree;
+  }
+}
+
+/**
+Puts a person at the front of the bucket for their current friend count
+@param id: the id of the person to link
+**/
+static void link_degree(uint32_t id)
+{
+  place_degree(id, friend_counts_by_id[id]);
+}
+
+/**
+Takes a person out of the bucket for a friend count
+@param id: the id of the person to unlink
+@param degree: the friend count of the bucket the person is in
+**/
+static void unlink_degree(uint32_t id, size_t degree)
+{
+  uint32_t prev = degree_prev_by_id[id];
+  uint32_t next = degree_next_by_id[id];
+  if(prev != NO_PERSON)
+  {
+    degree_next_by_id[prev] = next;
+  }
+  else
+  {
+    degree_buckets[degree] = next;
+  }
+  if(next != NO_PERSON)
+  {
+    degree_prev_by_id[next] = prev;
+  }
+  while(max_degree > 0 && degree_buckets[max_degree] == NO_PERSON)
+  {
+    max_degree-=1;
+  }
+}
+
+/**
+Moves a person to the bucket for their new friend count
+@param id: the id of the person whose friend count changed
+@param old_degree: the friend count before the change
+**/
+static void move_degree(uint32_t id, size_t old_degree)
+{
+  unlink_degree(id, old_degree);
+  link_degree(id);
+}
+
+/**
+Resizes one of the arrays by id to people_capacity elements
+@param category: what the array is counted as
+@param array: the array, NULL for a new one
+@param element: the size of one element
+@return the resized array
+**/
+static void* grow_by_id(mem_category_t category, void* array, size_t element)
+{
+  void* grown = mem_realloc(category, array, element * people_capacity);
+  assert(grown != NULL);
+  return(grown);
+}
+
+/**
+Hands out the next dense id, with every field of the person cleared and no
+friends yet
+@return the new id
+**/
+static uint32_t assign_id(void)
+{
+  if(people_count == people_capacity)
+  {
+    people_capacity = people_capacity == 0 ? 16 : people_capacity * 2;
+    names_by_id = grow_by_id(MEM_PEOPLE, names_by_id, sizeof(char*));
+    handles_by_id = grow_by_id(MEM_PEOPLE, handles_by_id, sizeof(char*));
+    friend_counts_by_id = grow_by_id(MEM_PEOPLE, friend_counts_by_id, sizeof(size_t));
+    max_friends_by_id = grow_by_id(MEM_PEOPLE, max_friends_by_id, sizeof(size_t));
+    offsets_by_id = grow_by_id(MEM_PEOPLE, offsets_by_id, sizeof(size_t));
+    versions_by_id = grow_by_id(MEM_PEOPLE, versions_by_id, sizeof(uint32_t));
+    shared_by_id = grow_by_id(MEM_PEOPLE, shared_by_id, sizeof(bool));
+    degree_prev_by_id = grow_by_id(MEM_PEOPLE, degree_prev_by_id, sizeof(uint32_t));
+    degree_next_by_id = grow_by_id(MEM_PEOPLE, degree_next_by_id, sizeof(uint32_t));
+    sorted_by_id = grow_by_id(MEM_PEOPLE, sorted_by_id, sizeof(uint32_t*));
+    sorted_valid_by_id = grow_by_id(MEM_PEOPLE, sorted_valid_by_id, sizeof(bool));
+    rendered_by_id = grow_by_id(MEM_PEOPLE, rendered_by_id, sizeof(rendered_t*));
+    packed_by_id = grow_by_id(MEM_PEOPLE, packed_by_id, sizeof(uint8_t*));
+    packed_counts_by_id = grow_by_id(MEM_PEOPLE, packed_counts_by_id, sizeof(size_t));
+    tails_by_id = grow_by_id(MEM_PEOPLE, tails_by_id, sizeof(uint32_t*));
+    tail_counts_by_id = grow_by_id(MEM_PEOPLE, tail_counts_by_id, sizeof(size_t));
+    component_parent = grow_by_id(MEM_INDEXES, component_parent, sizeof(uint32_t));
+    component_rank = grow_by_id(MEM_INDEXES, component_rank, sizeof(uint8_t));
+  }
+  uint32_t id = (uint32_t)people_count;
+  names_by_id[id] = NULL;
+  handles_by_id[id] = NULL;
+  friend_counts_by_id[id] = 0;
+  max_friends_by_id[id] = 0;
+  offsets_by_id[id] = 0;
+  versions_by_id[id] = 0;
+  shared_by_id[id] = false;
+  degree_prev_by_id[id] = NO_PERSON;
+  degree_next_by_id[id] = NO_PERSON;
+  sorted_by_id[id] = NULL;
+  sorted_valid_by_id[id] = false;
+  rendered_by_id[id] = NULL;
+  packed_by_id[id] = NULL;
+  packed_counts_by_id[id] = 0;
+  tails_by_id[id] = NULL;
+  tail_counts_by_id[id] = 0;
+  component_parent[id] = id;
+  component_rank[id] = 0;
+  component_count+=1;
+  people_count+=1;
+  return(id);
+}
+
+/**
+Gets the id the hashtable keeps for a handle
+@param hashtable: Hashtable containing people
+@param handle: a handle that is in the hashtable
+@return the id of the person
+**/
+static uint32_t handle_id(HashADT hashtable, const char* handle)
+{
+  return((uint32_t)(uintptr_t)ht_get(hashtable, handle));
+}
+
+/**
+Gets the friends array of a person in array mode
+@param id: the id of the person
+@return max_friends_by_id[id] friend ids, NO_FRIEND in the empty slots
+**/
+static uint32_t* friends_of(uint32_t id)
+{
+  return(adjacency + offsets_by_id[id]);
+}
+
+/**
+Gets where a person sits in the friends array of each of their friends
+@param id: the id of the person
+@return the slots, in the same positions as friends_of
+**/
+static uint32_t* slots_of(uint32_t id)
+{
+  return(adjacency_slots + offsets_by_id[id]);
+}
+
+/**
+Copies the friends arrays of everyone to the front of new buffers in id
+order, leaving out the entries given up by moves and removals. Not done
+while the live snapshot may still read the old entries
+**/
+static void compact_adjacency(void)
+{
+  uint32_t* friends = mem_malloc(MEM_FRIENDS, sizeof(uint32_t) * adjacency_capacity);
+  uint32_t* slots = mem_malloc(MEM_FRIENDS, sizeof(uint32_t) * adjacency_capacity);
+  assert(friends != NULL && slots != NULL);
+  size_t length = 0;
+  for(size_t i = 0; i < people_count; i++)
+  {
+    size_t max_friends = max_friends_by_id[i];
+    memcpy(friends + length, adjacency + offsets_by_id[i], sizeof(uint32_t) * max_friends);
+    memcpy(slots + length, adjacency_slots + offsets_by_id[i], sizeof(uint32_t) * max_friends);
+    offsets_by_id[i] = length;
+    length+=max_friends;
+  }
+  mem_free(MEM_FRIENDS, adjacency);
+  mem_free(MEM_FRIENDS, adjacency_slots);
+  adjacency = friends;
+  adjacency_slots = slots;
+  adjacency_length = length;
+  adjacency_garbage = 0;
+}
+
+/**
+Takes entries for a friends array from the end of adjacency, compacting it
+first once half of it is garbage, or else doubling it when it is full. The
+offsets of every person may change
+@param count: the number of entries wanted
+@return the offset of the first entry
+**/
+static size_t reserve_adjacency(size_t count)
+{
+  if(adjacency_length + count > adjacency_capacity && adjacency_garbage > adjacency_length / 2 &&
+     live_snapshot == NULL)
+  {
+    compact_adjacency();
+  }
+  if(adjacency_length + count > adjacency_capacity)
+  {
+    while(adjacency_length + count > adjacency_capacity)
+    {
+      adjacency_capacity = adjacency_capacity == 0 ? 256 : adjacency_capacity * 2;
+    }
+    adjacency = mem_realloc(MEM_FRIENDS, adjacency, sizeof(uint32_t) * adjacency_capacity);
+    adjacency_slots = mem_realloc(MEM_FRIENDS, adjacency_slots, sizeof(uint32_t) * adjacency_capacity);
+    assert(adjacency != NULL && adjacency_slots != NULL);
+  }
+  size_t offset = adjacency_length;
+  adjacency_length+=count;
+  return(offset);
+}
+
+/**
+Moves the friends array of a person to new entries at the end of adjacency,
+keeping every friend in the same slot and leaving the old entries as
+garbage, which the live snapshot may still be reading
+@param id: the id of the person
+@param max_friends: the new length of the array, at least the old one
+**/
+static void move_friends(uint32_t id, size_t max_friends)
+{
+  size_t old_max = max_friends_by_id[id];
+  size_t offset = reserve_adjacency(max_friends);
+  memcpy(adjacency + offset, friends_of(id), sizeof(uint32_t) * old_max);
+  memcpy(adjacency_slots + offset, slots_of(id), sizeof(uint32_t) * old_max);
+  memset(adjacency + offset + old_max, 0xff, sizeof(uint32_t) * (max_friends - old_max));
+  offsets_by_id[id] = offset;
+  max_friends_by_id[id] = max_friends;
+  adjacency_garbage+=old_max;
+}
+
+/**
+Compares two ids for qsort
+@param id1: pointer to the first id
+@param id2: pointer to the second id
+@return negative, zero or positive as id1 is below, equal or above id2
+**/
+static int compare_ids(const void *id1, const void *id2)
+{
+  uint32_t first = *(const uint32_t*)id1;
+  uint32_t second = *(const uint32_t*)id2;
+  return (first > second) - (first < second);
+}
+
+/**
+Lists the ids of the people who have not been removed
+@param ids: receives the ids in increasing order, room for people_count
+@return the number of ids stored, which is size_of_hashtable
+**/
+static size_t live_ids(uint32_t* ids)
+{
+  size_t live = 0;
+  for(size_t i = 0; i < people_count; i++)
+  {
+    if(handles_by_id[i] != NULL)
+    {
+      ids[live] = (uint32_t)i;
+      live+=1;
+    }
+  }
+  return(live);
+}
+
+/**
+Starts walking the friends of a person
+@param iter: the walk to start
+@param id: the id of the person whose friends are walked
+**/
+static void friend_iter_start(friend_iter_t* iter, uint32_t id)
+{
+  iter->id = id;
+  iter->slot = 0;
+  iter->cursor = packed_by_id[id];
+  iter->decoded = 0;
+  iter->last = 0;
+}
+
+/**
+Gets the next friend of a walk. Compressed friends come in increasing id
+order followed by the ones not merged yet, array friends in slot order.
+Packed ids of removed people are skipped
+@param iter: the walk
+@return the id of the next friend, or NO_PERSON when there are no more
+**/
+static uint32_t friend_iter_next(friend_iter_t* iter)
+{
+  uint32_t id = iter->id;
+  if(compressed_adjacency == true)
+  {
+    while(iter->decoded < packed_counts_by_id[id])
+    {
+      uint32_t gap;
+      iter->cursor = varint_read(iter->cursor, &gap);
+      iter->last+=gap;
+      iter->decoded+=1;
+      if(handles_by_id[iter->last] != NULL)
+      {
+        return(iter->last);
+      }
+    }
+    if(iter->slot < tail_counts_by_id[id])
+    {
+      iter->slot+=1;
+      return(tails_by_id[id][iter->slot - 1]);
+    }
+    return(NO_PERSON);
+  }
+  const uint32_t* friends = friends_of(id);
+  while(iter->slot < max_friends_by_id[id])
+  {
+    iter->slot+=1;
+    if(friends[iter->slot - 1] != NO_FRIEND)
+    {
+      return(friends[iter->slot - 1]);
+    }
+  }
+  return(NO_PERSON);
+}
+
+/**
+Replaces the packed ids of a compressed person. The old ones are freed
+unless the live snapshot still shows them, in which case it keeps them
+@param id: the id of the person
+@param ids: the new friend ids, strictly increasing
+@param count: the number of ids
+**/
+static void repack_friends(uint32_t id, const uint32_t* ids, size_t count)
+{
+  uint8_t* packed = mem_malloc(MEM_FRIENDS, count * VARINT_MAX_BYTES + 1);
+  assert(packed != NULL);
+  size_t length = varint_encode(ids, count, packed);
+  packed = mem_realloc(MEM_FRIENDS, packed, length + 1);
+  assert(packed != NULL);
+  if(shared_by_id[id] == true)
+  {
+    shared_by_id[id] = false;
+  }
+  else
+  {
+    mem_free(MEM_FRIENDS, packed_by_id[id]);
+  }
+  packed_by_id[id] = packed;
+  packed_counts_by_id[id] = count;
+}
+
+/**
+Merges the tail of a compressed person into its packed ids, dropping the
+ids of removed people left in them
+@param id: the id of the person
+**/
+static void merge_tail(uint32_t id)
+{
+  size_t tail_count = tail_counts_by_id[id];
+  size_t packed_count = packed_counts_by_id[id];
+  if(tail_count == 0 && packed_count == friend_counts_by_id[id])
+  {
+    return;
+  }
+  uint32_t* tail = tails_by_id[id];
+  size_t count = packed_count + tail_count;
+  uint32_t* ids = mem_malloc(MEM_INDEXES, sizeof(uint32_t) * (count + 1));
+  uint32_t* merged = mem_malloc(MEM_INDEXES, sizeof(uint32_t) * (count + 1));
+  assert(ids != NULL && merged != NULL);
+  varint_decode(packed_by_id[id], packed_count, ids);
+  if(tail_count > 0)
+  {
+    qsort(tail, tail_count, sizeof(uint32_t), compare_ids);
+  }
+  size_t i = 0;
+  size_t j = 0;
+  size_t k = 0;
+  while(i < packed_count || j < tail_count)
+  {
+    if(j == tail_count || (i < packed_count && ids[i] < tail[j]))
+    {
+      if(handles_by_id[ids[i]] != NULL)
+      {
+        merged[k] = ids[i];
+        k+=1;
+      }
+      i+=1;
+    }
+    else
+    {
+      merged[k] = tail[j];
+      j+=1;
+      k+=1;
+    }
+  }
+  repack_friends(id, merged, k);
+  if(tail_count > 0)
+  {
+    // most people stop gaining friends, so an empty tail is not kept around
+    mem_free(MEM_FRIENDS, tail);
+    tails_by_id[id] = NULL;
+    tail_counts_by_id[id] = 0;
+    // the friends are walked in a new order, so print output changes
+    versions_by_id[id]+=1;
+  }
+  mem_free(MEM_INDEXES, ids);
+  mem_free(MEM_INDEXES, merged);
+}
+
+/**
+Tells whether a compressed person has a friend, stopping early in the packed
+ids once they pass the id looked for
+@param id: the id of the person
+@param buddy: the id of the friend
+@return true if buddy is among the friends
+**/
+static bool compressed_contains(uint32_t id, uint32_t buddy)
+{
+  for(size_t i = 0; i < tail_counts_by_id[id]; i++)
+  {
+    if(tails_by_id[id][i] == buddy)
+    {
+      return(true);
+    }
+  }
+  const uint8_t* cursor = packed_by_id[id];
+  uint32_t last = 0;
+  for(size_t i = 0; i < packed_counts_by_id[id]; i++)
+  {
+    uint32_t gap;
+    cursor = varint_read(cursor, &gap);
+    last+=gap;
+    if(last >= buddy)
+    {
+      return(last == buddy);
+    }
+  }
+  return(false);
+}
+
+/**
+Adds a friend to a compressed person, merging the tail once it is full. The
+tail is only allocated while it holds ids
+@param id: the id of the person
+@param buddy: the id of the new friend
+**/
+static void compressed_insert(uint32_t id, uint32_t buddy)
+{
+  if(tails_by_id[id] == NULL)
+  {
+    tails_by_id[id] = mem_malloc(MEM_FRIENDS, sizeof(uint32_t) * TAIL_LIMIT);
+    assert(tails_by_id[id] != NULL);
+  }
+  tails_by_id[id][tail_counts_by_id[id]] = buddy;
+  tail_counts_by_id[id]+=1;
+  if(tail_counts_by_id[id] == TAIL_LIMIT)
+  {
+    merge_tail(id);
+  }
+}
+
+/**
+Takes a friend away from the tail of a compressed person
+@param id: the id of the person
+@param buddy: the id of the friend
+@return true if buddy was in the tail
+**/
+static bool tail_erase(uint32_t id, uint32_t buddy)
+{
+  uint32_t* tail = tails_by_id[id];
+  for(size_t i = 0; i < tail_counts_by_id[id]; i++)
+  {
+    if(tail[i] == buddy)
+    {
+      tail[i] = tail[tail_counts_by_id[id] - 1];
+      tail_counts_by_id[id]-=1;
+      if(tail_counts_by_id[id] == 0)
+      {
+        mem_free(MEM_FRIENDS, tail);
+        tails_by_id[id] = NULL;
+      }
+      return(true);
+    }
+  }
+  return(false);
+}
+
+/**
+Takes a friend away from a compressed person, repacking the packed ids
+without it and without the ids of removed people left in them
+@param id: the id of the person
+@param buddy: the id of the friend
+**/
+static void compressed_erase(uint32_t id, uint32_t buddy)
+{
+  if(tail_erase(id, buddy) == true)
+  {
+    return;
+  }
+  size_t packed_count = packed_counts_by_id[id];
+  uint32_t* ids = mem_malloc(MEM_INDEXES, sizeof(uint32_t) * (packed_count + 1));
+  assert(ids != NULL);
+  varint_decode(packed_by_id[id], packed_count, ids);
+  size_t kept = 0;
+  for(size_t i = 0; i < packed_count; i++)
+  {
+    if(ids[i] != buddy && handles_by_id[ids[i]] != NULL)
+    {
+      ids[kept] = ids[i];
+      kept+=1;
+    }
+  }
+  repack_friends(id, ids, kept);
+  mem_free(MEM_INDEXES, ids);
+}
+
+/**
+Takes a person being removed away from a compressed friend. Out of the tail
+the id is simply dropped, but out of the packed ids it is left in place,
+since the person has no handle once removed and every reader skips it.
+Once half the packed ids are left like that they are repacked
+@param id: the id of the friend, whose friend count is already lowered
+@param buddy: the id of the person being removed
+**/
+static void compressed_forget(uint32_t id, uint32_t buddy)
+{
+  if(tail_erase(id, buddy) == true)
+  {
+    return;
+  }
+  size_t packed_count = packed_counts_by_id[id];
+  size_t left = packed_count + tail_counts_by_id[id] - friend_counts_by_id[id];
+  if(left * 2 > packed_count)
+  {
+    compressed_erase(id, buddy);
+  }
+}
+
+/**
+Gets the ids of a persons friends in increasing order. Array friends are
+sorted into sorted_by_id, rebuilt only when the friends array changed
+since the last call. Compressed friends are decoded into the buffer instead,
+so no uncompressed copy is kept for the person
+@param id: the id of the person whose friends are wanted
+@param buffer: where compressed friends are decoded, good until the next
+               call with the same buffer
+@return the sorted ids, as many as the person has friends
+**/
+static const uint32_t* sorted_friend_ids(uint32_t id, id_buffer_t* buffer)
+{
+  size_t friend_count = friend_counts_by_id[id];
+  if(compressed_adjacency == true)
+  {
+    merge_tail(id);
+    size_t wanted = friend_count + 1;
+    if(buffer->capacity < wanted)
+    {
+      buffer->capacity = buffer->capacity * 2 > wanted ? buffer->capacity * 2 : wanted;
+      buffer->ids = realloc(buffer->ids, sizeof(uint32_t) * buffer->capacity);
+      assert(buffer->ids != NULL);
+    }
+    varint_decode(packed_by_id[id], packed_counts_by_id[id], buffer->ids);
+    return(buffer->ids);
+  }
+  if(sorted_valid_by_id[id] == false)
+  {
+    const uint32_t* friends = friends_of(id);
+    size_t max_friends = max_friends_by_id[id];
+    uint32_t* sorted = mem_realloc(MEM_INDEXES, sorted_by_id[id], sizeof(uint32_t) * (friend_count + 1));
+    assert(sorted != NULL);
+    size_t count = 0;
+    for(size_t i = 0; i < max_friends && count < friend_count; i++)
+    {
+      if(friends[i] != NO_FRIEND)
+      {
+        sorted[count] = friends[i];
+        count+=1;
+      }
+    }
+    qsort(sorted, count, sizeof(uint32_t), compare_ids);
+    sorted_by_id[id] = sorted;
+    sorted_valid_by_id[id] = true;
+  }
+  return(sorted_by_id[id]);
+}
+
+//bytes of print output the print cache may hold, 0 when it is off
+size_t print_cache_budget = 0;
+//bytes of print output the print cache holds
+size_t print_cache_bytes = 0;
+//the number of people with print output in the print cache
+size_t print_cache_entries = 0;
+//prints answered from the print cache and prints that had to be formatted
+size_t print_cache_hits = 0;
+size_t print_cache_misses = 0;
+//the most and the least recently printed entries in the print cache
+rendered_t* print_cache_head = NULL;
+rendered_t* print_cache_tail = NULL;
+
+/**
+Unlinks an entry from the list of the print cache
+@param entry: the entry, which is linked
+**/
+static void unlink_rendered(rendered_t* entry)
+{
+  if(entry->prev != NULL)
+  {
+    entry->prev->next = entry->next;
+  }
+  else
+  {
+    print_cache_head = entry->next;
+  }
+  if(entry->next != NULL)
+  {
+    entry->next->prev = entry->prev;
+  }
+  else
+  {
+    print_cache_tail = entry->prev;
+  }
+}
+
+/**
+Puts an entry at the front of the print cache, as the most recently printed
+@param entry: the entry, which is not linked
+**/
+static void link_rendered(rendered_t* entry)
+{
+  entry->prev = NULL;
+  entry->next = print_cache_head;
+  if(print_cache_head != NULL)
+  {
+    print_cache_head->prev = entry;
+  }
+  else
+  {
+    print_cache_tail = entry;
+  }
+  print_cache_head = entry;
+}
+
+/**
+Takes a person out of the print cache, freeing the print output kept
+@param id: the id of the person, who need not be in the cache
+**/
+static void drop_rendered(uint32_t id)
+{
+  rendered_t* entry = rendered_by_id[id];
+  if(entry == NULL)
+  {
+    return;
+  }
+  unlink_rendered(entry);
+  print_cache_bytes-=entry->length;
+  print_cache_entries-=1;
+  mem_free(MEM_INDEXES, entry);
+  rendered_by_id[id] = NULL;
+}
+
+/**
+Drops the least recently printed people from the print cache until it holds
+no more than a number of bytes
+@param bytes: the most bytes the cache may keep holding
+**/
+static void trim_rendered(size_t bytes)
+{
+  while(print_cache_bytes > bytes)
+  {
+    drop_rendered(print_cache_tail->id);
+  }
+}
+
+/**
+Frees everything a person owns, name and handle included, and clears their
+fields, leaving the id unused. Friends the live snapshot still references
+are left to it, and so are a name and handle set to NULL beforehand. The
+hashtable does not free its keys, so the person must be out of it first
+@param id: the id of the person to free
+**/
+static void free_person(uint32_t id)
+{
+  drop_rendered(id);
+  adjacency_garbage+=max_friends_by_id[id];
+  max_friends_by_id[id] = 0;
+  friend_counts_by_id[id] = 0;
+  mem_free(MEM_INDEXES, sorted_by_id[id]);
+  sorted_by_id[id] = NULL;
+  sorted_valid_by_id[id] = false;
+  if(shared_by_id[id] == false)
+  {
+    mem_free(MEM_FRIENDS, packed_by_id[id]);
+  }
+  shared_by_id[id] = false;
+  packed_by_id[id] = NULL;
+  packed_counts_by_id[id] = 0;
+  mem_free(MEM_FRIENDS, tails_by_id[id]);
+  tails_by_id[id] = NULL;
+  tail_counts_by_id[id] = 0;
+  mem_free(MEM_STRINGS, names_by_id[id]);
+  mem_free(MEM_STRINGS, handles_by_id[id]);
+  names_by_id[id] = NULL;
+  handles_by_id[id] = NULL;
+}
+
+/**
+Gives a person a private copy of its friends array if the live snapshot
+still references it, so the caller can change the array freely. Packed ids
+are never changed in place, repack_friends leaves the old ones to the snapshot
+@param id: the id of the person about to have its friends changed
+**/
+static void unshare_friends(uint32_t id)
+{
+  if(shared_by_id[id] == true && compressed_adjacency == false)
+  {
+    move_friends(id, max_friends_by_id[id]);
+    shared_by_id[id] = false;
+  }
+}
+
+/**
+Adds a person to the person store under a new id, and to the hashtable where
+the key is the handle and the id is the value
 @param hashtable: Hashtable used to add the person
 @param first_name: the first name of the person
 @param last_name: the last name of the person
 @param handle: the handle of the person
 @param file: true if command was called from file input, false otherwise
 **/
-void add_person(HashADT hashtable, char* first_name, char* last_name, char* handle, bool file)
+void add_person(HashADT hashtable, char* first_name, char* last_name, char* handle, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"add\" \"%s\" \"%s\" \"%s\"\n", first_name, last_name, handle);
+  }
+  if(ht_has(hashtable, handle) == true)
+  {
+    fprintf(stdout, "error: handle \"%s\" is already in use\n", handle);
+    fflush(stdout);
+    return;
+  }
+  else
+  {
+    size_t first_len = strlen(first_name);
+    size_t last_len = strlen(last_name);
+    char* full_name = (char*)malloc(first_len + 1 + last_len + 1);
+    snprintf(full_name, first_len + 1 + last_len + 1, "%s %s", first_name, last_name);
+    bool first_name_alphabet = true;
+    bool last_name_alphabet = true;
+    bool handle_alphabet_number = true;
+    for(size_t i = 0; i < strlen(first_name); i++)
+    {
+      if(isalpha(first_name[i]) == 0)
+      {
+        first_name_alphabet = false;
+        break;
+      }
+    }
+    for(size_t i = 0; i < strlen(last_name); i++) 
+    {
+      if(isalpha(last_name[i]) == 0)
+      {
+        last_name_alphabet = false;
+        break;
+      }
+    }
+    for(size_t i = 0; i < strlen(handle); i++) 
+    {
+      if(!isalpha(handle[i]) && !isdigit(handle[i]))
+      {
+        handle_alphabet_number = false;
+        break;
+      }
+    }
+    if(first_name_alphabet == false)
+    {
+      fprintf(stdout,"error: argument \"%s\" is invalid\n", first_name);
+      free(full_name);
+      fflush(stdout);
+      return;
+    }
+    else if(last_name_alphabet == false)
+    {
+      fprintf(stdout,"error: argument \"%s\" is invalid\n", last_name); 
+      free(full_name);
+      fflush(stdout);
+      return;
+    }
+    else if(handle_alphabet_number == false)
+    {
+      fprintf(stdout,"error: argument \"%s\" is invalid\n", handle); 
+      free(full_name);
+      fflush(stdout);
+      return;
+    }
+    uint32_t id = assign_id();
+    names_by_id[id] = mem_strdup(MEM_STRINGS, full_name);
+    handles_by_id[id] = mem_strdup(MEM_STRINGS, handle);
+    if(compressed_adjacency == false)
+    {
+      offsets_by_id[id] = reserve_adjacency(16);
+      max_friends_by_id[id] = 16;
+      memset(friends_of(id), 0xff, sizeof(uint32_t) * max_friends_by_id[id]);
+    }
+    link_degree(id);
+    if(name_index == NULL)
+    {
+      name_index = trie_create();
+    }
+    trie_insert(name_index, first_name, id);
+    trie_insert(name_index, last_name, id);
+    ht_put(hashtable, handles_by_id[id], (void*)(uintptr_t)id);
+    size_of_hashtable+=1;
+    graph_version+=1;
+    free(full_name);
+  }
+}
+
+/**
+Makes sure a friends array can be changed by link_friends and unlink_friends
+without moving it, copying it away from the live snapshot and, when a
+friend may be added, growing it if it is full. Moves change adjacency for
+everyone, so this is done before commands run in parallel
+@param id: the id of the person
+@param befriend: true if a friend may be added
+**/
+static void prepare_friends(uint32_t id, bool befriend)
+{
+  if(compressed_adjacency == true)
+  {
+    return;
+  }
+  unshare_friends(id);
+  if(befriend == true && friend_counts_by_id[id] == max_friends_by_id[id])
+  {
+    move_friends(id, max_friends_by_id[id] * 2);
+  }
+}
+
+/**
+Makes two people friends in their friends lists only. Their degree buckets,
+groups and the counts are left to note_friendship, so calls on different
+people touch nothing in common and may run at the same time, once
+prepare_friends has been called for both
+@param id1: the id of one of the people
+@param id2: the id of the other person
+@return false if they were already friends
+**/
+static bool link_friends(uint32_t id1, uint32_t id2)
+{
+  bool friend_already = false;
+  if(compressed_adjacency == true)
+  {
+    friend_already = compressed_contains(id1, id2);
+  }
+  const uint32_t* friends = friends_of(id1);
+  for(size_t i = 0; i < max_friends_by_id[id1]; i++)
+  {
+    if(friends[i] == id2)
+    {
+      friend_already = true;
+      break;
+    }
+  }
+  if(friend_already == true)
+  {
+    return(false);
+  }
+  sorted_valid_by_id[id1] = false;
+  versions_by_id[id1]+=1;
+  sorted_valid_by_id[id2] = false;
+  versions_by_id[id2]+=1;
+  if(compressed_adjacency == true)
+  {
+    compressed_insert(id1, id2);
+    friend_counts_by_id[id1]+=1;
+    compressed_insert(id2, id1);
+    friend_counts_by_id[id2]+=1;
+    return(true);
+  }
+  prepare_friends(id1, true);
+  prepare_friends(id2, true);
+  uint32_t* friends1 = friends_of(id1);
+  uint32_t* friends2 = friends_of(id2);
+  size_t slot1 = 0;
+  size_t slot2 = 0;
+  for(size_t i = 0; i < max_friends_by_id[id1]; i++)
+  {
+    if(friends1[i] == NO_FRIEND)
+    {
+      slot1 = i;
+      break;
+    }
+  }
+  for(size_t i = 0; i < max_friends_by_id[id2]; i++)
+  {
+    if(friends2[i] == NO_FRIEND)
+    {
+      slot2 = i;
+      break;
+    }
+  }
+  // each side remembers where it sits in the other's array
+  friends1[slot1] = id2;
+  slots_of(id1)[slot1] = (uint32_t)slot2;
+  friend_counts_by_id[id1]+=1;
+  friends2[slot2] = id1;
+  slots_of(id2)[slot2] = (uint32_t)slot1;
+  friend_counts_by_id[id2]+=1;
+  return(true);
+}
+
+/**
+Records a friendship made by link_friends in the degree buckets, the groups
+and the counts
+@param id1: the id of one of the people
+@param degree1: the friend count of id1 right after the friendship
+@param id2: the id of the other person
+@param degree2: the friend count of id2 right after the friendship
+**/
+static void note_friendship(uint32_t id1, size_t degree1, uint32_t id2, size_t degree2)
+{
+  unlink_degree(id1, degree1 - 1);
+  place_degree(id1, degree1);
+  unlink_degree(id2, degree2 - 1);
+  place_degree(id2, degree2);
+  total_friendships+=1;
+  join_components(id1, id2);
+  graph_version+=1;
+}
+
+/**
+Ends a friendship in the friends lists of two people only, leaving the rest
+to note_unfriending, so calls on different people may run at the same time
+once prepare_friends has been called for both
+@param id1: the id of one of the people
+@param id2: the id of the other person
+@return false if they were not friends
+**/
+static bool unlink_friends(uint32_t id1, uint32_t id2)
+{
+  bool friends = false;
+  if(compressed_adjacency == true && compressed_contains(id1, id2) == true)
+  {
+    compressed_erase(id1, id2);
+    sorted_valid_by_id[id1] = false;
+    versions_by_id[id1]+=1;
+    friend_counts_by_id[id1]-=1;
+    compressed_erase(id2, id1);
+    sorted_valid_by_id[id2] = false;
+    versions_by_id[id2]+=1;
+    friend_counts_by_id[id2]-=1;
+    friends = true;
+  }
+  for(size_t i = 0; i < max_friends_by_id[id1]; i++)
+  {
+    if(friends_of(id1)[i] == id2)
+    {
+      size_t slot2 = slots_of(id1)[i];
+      unshare_friends(id1);
+      friends_of(id1)[i] = NO_FRIEND;
+      sorted_valid_by_id[id1] = false;
+      versions_by_id[id1]+=1;
+      friend_counts_by_id[id1]-=1;
+      unshare_friends(id2);
+      friends_of(id2)[slot2] = NO_FRIEND;
+      sorted_valid_by_id[id2] = false;
+      versions_by_id[id2]+=1;
+      friend_counts_by_id[id2]-=1;
+      friends = true;
+      break;
+    }
+  }
+  return(friends);
+}
+
+/**
+Records a friendship ended by unlink_friends in the degree buckets, the
+groups and the counts
+@param id1: the id of one of the people
+@param degree1: the friend count of id1 right after the unfriending
+@param id2: the id of the other person
+@param degree2: the friend count of id2 right after the unfriending
+**/
+static void note_unfriending(uint32_t id1, size_t degree1, uint32_t id2, size_t degree2)
+{
+  unlink_degree(id1, degree1 + 1);
+  place_degree(id1, degree1);
+  unlink_degree(id2, degree2 + 1);
+  place_degree(id2, degree2);
+  total_friendships-=1;
+  mark_component_dirty(id1, id2);
+  graph_version+=1;
+}
+
+/**
+Creates a friendship between two people and added to each other friends list
+@param hashtable: Hashtable containing people
+@param handle1: the handle of one of the people
+@param handle2: the handle of the other person
+@param file: true if command was called from file input, false otherwise
+**/
+void add_friend(HashADT hashtable, char* handle1, char* handle2, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"friend\" \"%s\" \"%s\"\n", handle1, handle2);
+  }
+  if(ht_has(hashtable, handle1) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle1);
+    fflush(stdout);
+  }
+  else if(ht_has(hashtable, handle2) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle2);
+    fflush(stdout);
+  }
+  else if(strcmp(handle1, handle2) == 0)
+  {
+    fprintf(stdout, "error: \"%s\" and \"%s\" are the same person\n", handle1, handle2);
+    fflush(stdout);
+  }
+  else
+  {
+    uint32_t id1 = handle_id(hashtable, handle1);
+    uint32_t id2 = handle_id(hashtable, handle2);
+    if(link_friends(id1, id2) == false)
+    {
+      fprintf(stdout,"%s and %s are already friends.\n", handle1, handle2);
+      fflush(stdout);
+    }
+    else
+    {
+      note_friendship(id1, friend_counts_by_id[id1], id2, friend_counts_by_id[id2]);
+      printf("%s and %s are now friends.\n", handle1, handle2);
+    }
+  }
+}
+
+/**
+Unfriends a person by getting rid of them in there friends list
+@param hashtable: Hashtable containing people
+@param handle1: the handle of one of the people
+@param handle2: the handle of the other person
+@param file: true if command was called from file input, false otherwise
+**/
+void unfriend_person(HashADT hashtable, char* handle1, char* handle2, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"unfriend\" \"%s\" \"%s\"\n", handle1, handle2);
+  }
+  if(ht_has(hashtable, handle1) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle1);
+    fflush(stdout);
+  }
+  else if(ht_has(hashtable, handle2) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle2);
+    fflush(stdout);
+  }
+  else if(strcmp(handle1, handle2) == 0)
+  {
+    fprintf(stdout, "error: \"%s\" and \"%s\" are the same person\n", handle1, handle2);
+    fflush(stdout);
+  }
+  else
+  {
+    uint32_t id1 = handle_id(hashtable, handle1);
+    uint32_t id2 = handle_id(hashtable, handle2);
+    if(unlink_friends(id1, id2) == true)
+    {
+      note_unfriending(id1, friend_counts_by_id[id1], id2, friend_counts_by_id[id2]);
+      printf("%s and %s are no longer friends.\n", handle1, handle2);
+    }
+    else
+    {
+      fprintf(stdout,"%s and %s are not friends.\n", handle1, handle2);
+      fflush(stdout);
+    }
+  }
+}
+
+/**
+Writes the line saying how many friends a person has to a stream
+@param out: the stream
+@param handle: the handle of the person
+@param name: the name of the person
+@param friend_count: the number of friends
+**/
+static void write_friend_count(FILE* out, char* handle, char* name, size_t friend_count)
+{
+  if(friend_count > 1)
+  {
+    fprintf(out, "%s (%s) has %ld friends\n", handle, name, friend_count);
+  }
+  else if(friend_count == 1)
+  {
+    fprintf(out, "%s (%s) has 1 friend\n", handle, name);
+  }
+  else
+  {
+    fprintf(out, "%s (%s) has no friends\n", handle, name);
+  }
+}
+
+/**
+Prints the line saying how many friends a person has
+@param handle: the handle of the person
+@param name: the name of the person
+@param friend_count: the number of friends
+**/
+static void print_friend_count(char* handle, char* name, size_t friend_count)
+{
+  write_friend_count(stdout, handle, name, friend_count);
+}
+
+/**
+Gets the handle and name of a person as the live snapshot sees them. People
+removed since it was taken are gone from the store, but the snapshot keeps
+their strings by id until it is dropped
+@param id: the id of the person, below live_snapshot->ids
+@param name: set to the name of the person
+@return the handle of the person
+**/
+static char* snapshot_handle(uint32_t id, char** name)
+{
+  if(handles_by_id[id] != NULL)
+  {
+    *name = names_by_id[id];
+    return(handles_by_id[id]);
+  }
+  *name = live_snapshot->names[id];
+  return(live_snapshot->handles[id]);
+}
+
+/**
+Prints the persons handle along with the friends found in a snapshot friends
+array
+@param handle: the handle of the person
+@param name: the name of the person
+@param friends: the friends array, which may have NO_FRIEND holes
+@param friend_count: the number of friends in the array
+@param max_friends: the length of the friends array
+**/
+static void print_friends(char* handle, char* name, const uint32_t* friends, size_t friend_count, size_t max_friends)
+{
+  print_friend_count(handle, name, friend_count);
+  size_t printed = 0;
+  for(size_t i = 0; i < max_friends && printed < friend_count; i++)
+  {
+    if(friends[i] != NO_FRIEND)
+    {
+      char* buddy_name;
+      char* buddy_handle = snapshot_handle(friends[i], &buddy_name);
+      printf("\t%s (%s)\n", buddy_handle, buddy_name);
+      printed+=1;
+    }
+  }
+}
+
+/**
+Finds a person in the newest image a read replica serves, saying so if the
+handle is unknown or nothing has been published
+@param handle: the handle of the person
+@param image: set to the image the person was found in
+@return the person, or NULL
+**/
+static const image_person_t* replica_find(char* handle, const image_header_t** image)
+{
+  *image = image_current(replica);
+  if(*image == NULL)
+  {
+    fprintf(stdout, "error: no image has been published\n");
+    fflush(stdout);
+    return(NULL);
+  }
+  const image_person_t* person = image_find(*image, handle);
+  if(person == NULL)
+  {
+    fprintf(stdout,"error: handle \"%s\" is unknown\n", handle);
+    fflush(stdout);
+  }
+  return(person);
+}
+
+/**
+Prints a person and their friends through the print cache. Output kept from
+an earlier print is written again as it is unless the friends changed since,
+otherwise it is formatted afresh and kept, dropping the least recently
+printed people until it fits in print_cache_budget
+@param id: the id of the person
+**/
+static void print_cached(uint32_t id)
+{
+  rendered_t* entry = rendered_by_id[id];
+  if(entry != NULL && entry->version == versions_by_id[id])
+  {
+    print_cache_hits+=1;
+    if(entry != print_cache_head)
+    {
+      unlink_rendered(entry);
+      link_rendered(entry);
+    }
+    fwrite(entry->text, 1, entry->length, stdout);
+    return;
+  }
+  print_cache_misses+=1;
+  drop_rendered(id);
+  char* text = NULL;
+  size_t length = 0;
+  FILE* out = open_memstream(&text, &length);
+  assert(out != NULL);
+  write_friend_count(out, handles_by_id[id], names_by_id[id], friend_counts_by_id[id]);
+  friend_iter_t iter;
+  friend_iter_start(&iter, id);
+  for(uint32_t buddy = friend_iter_next(&iter); buddy != NO_PERSON; buddy = friend_iter_next(&iter))
+  {
+    fprintf(out, "\t%s (%s)\n", handles_by_id[buddy], names_by_id[buddy]);
+  }
+  fclose(out);
+  fwrite(text, 1, length, stdout);
+  if(length <= print_cache_budget)
+  {
+    trim_rendered(print_cache_budget - length);
+    entry = mem_malloc(MEM_INDEXES, sizeof(rendered_t) + length);
+    assert(entry != NULL);
+    entry->id = id;
+    entry->length = length;
+    entry->version = versions_by_id[id];
+    memcpy(entry->text, text, length);
+    rendered_by_id[id] = entry;
+    link_rendered(entry);
+    print_cache_bytes+=length;
+    print_cache_entries+=1;
+  }
+  free(text);
+}
+
+/**
+Prints the persons handle along with the person friends
+@param hashtable: Hashtable containing people
+@param handle: the handle of the person
+@param file: true if command was called from file input, false otherwise
+**/
+void print_handle(HashADT hashtable, char* handle, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"print\" \"%s\"\n", handle);
+  }
+  if(replica != NULL)
+  {
+    const image_header_t* image;
+    const image_person_t* person = replica_find(handle, &image);
+    if(person != NULL)
+    {
+      const uint32_t* friends = image_friends(image, person);
+      print_friend_count(handle, (char*)image_string(image, person->name), person->friend_count);
+      for(size_t i = 0; i < person->friend_count; i++)
+      {
+        const image_person_t* buddy = image_person(image, friends[i]);
+        printf("\t%s (%s)\n", image_string(image, buddy->handle), image_string(image, buddy->name));
+      }
+    }
+  }
+  else if(ht_has(hashtable, handle) == false)
+  {
+    fprintf(stdout,"error: handle \"%s\" is unknown\n", handle);
+    fflush(stdout);
+  }
+  else
+  {
+    uint32_t id = handle_id(hashtable, handle);
+    if(print_cache_budget > 0)
+    {
+      print_cached(id);
+      return;
+    }
+    print_friend_count(handle, names_by_id[id], friend_counts_by_id[id]);
+    friend_iter_t iter;
+    friend_iter_start(&iter, id);
+    for(uint32_t buddy = friend_iter_next(&iter); buddy != NO_PERSON; buddy = friend_iter_next(&iter))
+    {
+      printf("\t%s (%s)\n", handles_by_id[buddy], names_by_id[buddy]);
+    }
+  }
+}
+/**
+Prints the persons handle along with the number of friends the person has
+@param hashtable: Hashtable containing people
+@param handle: the handle of the person
+@param file: true if command was called from file input, false otherwise
+**/
+
+void print_size(HashADT hashtable, char* handle, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"size\" \"%s\"\n", handle);
+  }
+  if(replica != NULL)
+  {
+    const image_header_t* image;
+    const image_person_t* person = replica_find(handle, &image);
+    if(person != NULL)
+    {
+      print_friend_count(handle, (char*)image_string(image, person->name), person->friend_count);
+    }
+  }
+  else if(ht_has(hashtable, handle) == false)
+  {
+    fprintf(stdout,"error: handle \"%s\" is unknown\n", handle);
+    fflush(stdout);
+  }
+  else
+  {
+    uint32_t id = handle_id(hashtable, handle);
+    if(friend_counts_by_id[id] > 1)
+    {
+      printf("%s (%s) has %ld friends\n", handle, names_by_id[id], friend_counts_by_id[id]);
+    }
+    else if(friend_counts_by_id[id] == 1)
+    {
+      printf("%s (%s) has 1 friend\n", handle, names_by_id[id]);
+    }
+    else
+    {
+      printf("%s (%s) has no friends\n", handle, names_by_id[id]);
+    }
+  }
+}
+/**
+Prints the statistics line for a number of people and friendships
+@param people: the number of people
+@param friendships: the number of friendships
+**/
+static void print_counts(size_t people, size_t friendships)
+{
+  if(people == 0)
+  {
+    printf("Statistics:  no people, no friendships\n");
+  }
+  else if(people == 1)
+  {
+    printf("Statistics:  1 person, no friendships\n");
+  }
+  else if(people > 1 && friendships == 0)
+  {
+    printf("Statistics:  %ld people, no friendships\n", people);
+  }
+  else if(people > 1 && friendships == 1)
+  {
+    printf("Statistics:  %ld people, 1 friendship\n", people);
+  }
+  else
+  {
+    printf("Statistics:  %ld people, %ld friendships\n", people, friendships);
+  }
+}
+
+/**
+Loops through the hashtable, and prints the number of people in the hashtable
+as well as the number of friendships
+@param hashtable: Hashtable containing people
+@param file: true if command was called from file input, false otherwise
+**/
+void print_stats(HashADT hashtable, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"stats\"\n");
+  }
+  if(replica != NULL)
+  {
+    const image_header_t* image = image_current(replica);
+    if(image == NULL)
+    {
+      fprintf(stdout, "error: no image has been published\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_counts(image->people, image->friendships);
+    }
+    return;
+  }
+  (void)hashtable;
+  // walk the friend counts by id rather than hashing every handle, removed
+  // ids count no friends
+  size_t total_friends = 0;
+  for(size_t i = 0; i < people_count; i++)
+  {
+    total_friends+=friend_counts_by_id[i];
+  }
+  print_counts(size_of_hashtable, total_friends/2);
+}
+
+/**
+Releases the live snapshot. Packed ids a writer has replaced since the
+snapshot was taken are freed, the rest go back to their people, and so do
+the friends arrays, which stay in adjacency until it is next compacted. The
+names and handles of people removed since are freed
+**/
+static void drop_snapshot(void)
+{
+  if(live_snapshot == NULL)
+  {
+    return;
+  }
+  for(size_t i = 0; i < live_snapshot->ids; i++)
+  {
+    if(shared_by_id[i] == true)
+    {
+      shared_by_id[i] = false;
+    }
+    else
+    {
+      mem_free(MEM_FRIENDS, live_snapshot->packed[i]);
+    }
+    mem_free(MEM_STRINGS, live_snapshot->names[i]);
+    mem_free(MEM_STRINGS, live_snapshot->handles[i]);
+  }
+  free(live_snapshot->offsets);
+  free(live_snapshot->packed);
+  free(live_snapshot->friend_counts);
+  free(live_snapshot->max_friends);
+  free(live_snapshot->names);
+  free(live_snapshot->handles);
+  free(live_snapshot);
+  live_snapshot = NULL;
+}
+
+/**
+Freezes the current people and friendships into the live snapshot, replacing
+any older one. No friend array is copied here, writers copy on their next change.
+The hashtable is not frozen, so snapshot queries find people by their live
+handles, and export always writes the live graph
+@param hashtable: Hashtable containing people
+@param file: true if command was called from file input, false otherwise
+**/
+void take_snapshot(HashADT hashtable, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"snapshot\"\n");
+  }
+  (void)hashtable;
+  drop_snapshot();
+  snapshot_t* snap = (snapshot_t*)malloc(sizeof(snapshot_t));
+  assert(snap != NULL);
+  snap->people = size_of_hashtable;
+  snap->ids = people_count;
+  snap->offsets = malloc(sizeof(size_t) * (people_count + 1));
+  snap->packed = malloc(sizeof(uint8_t*) * (people_count + 1));
+  snap->friend_counts = malloc(sizeof(size_t) * (people_count + 1));
+  snap->max_friends = malloc(sizeof(size_t) * (people_count + 1));
+  snap->names = calloc(people_count + 1, sizeof(char*));
+  snap->handles = calloc(people_count + 1, sizeof(char*));
+  assert(snap->offsets != NULL && snap->packed != NULL && snap->friend_counts != NULL && snap->max_friends != NULL);
+  assert(snap->names != NULL && snap->handles != NULL);
+  size_t total_friends = 0;
+  for(uint32_t id = 0; id < people_count; id++)
+  {
+    if(compressed_adjacency == true)
+    {
+      merge_tail(id);
+    }
+    snap->offsets[id] = offsets_by_id[id];
+    snap->packed[id] = packed_by_id[id];
+    snap->friend_counts[id] = friend_counts_by_id[id];
+    snap->max_friends[id] = max_friends_by_id[id];
+    shared_by_id[id] = handles_by_id[id] != NULL;
+    total_friends+=friend_counts_by_id[id];
+  }
+  live_snapshot = snap;
+  if(total_friends == 0)
+  {
+    printf("Snapshot taken: %ld people, no friendships\n", snap->people);
+  }
+  else if(total_friends/2 == 1)
+  {
+    printf("Snapshot taken: %ld people, 1 friendship\n", snap->people);
+  }
+  else
+  {
+    printf("Snapshot taken: %ld people, %ld friendships\n", snap->people, total_friends/2);
+  }
+}
+
+/**
+Prints the number of people and friendships as of the live snapshot
+@param file: true if command was called from file input, false otherwise
+**/
+void snapshot_stats(bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"snapshot\" \"stats\"\n");
+  }
+  if(live_snapshot == NULL)
+  {
+    fprintf(stdout, "error: no snapshot has been taken\n");
+    fflush(stdout);
+    return;
+  }
+  size_t total_friends = 0;
+  for(size_t i = 0; i < live_snapshot->ids; i++)
+  {
+    total_friends+=live_snapshot->friend_counts[i];
+  }
+  print_counts(live_snapshot->people, total_friends/2);
+}
+
+/**
+Prints a persons friends as of the live snapshot. The person is looked up by
+live handle, so someone removed since the snapshot is unknown here even though
+they still show up among the friends of others
+@param hashtable: Hashtable containing people
+@param handle: the handle of the person
+@param file: true if command was called from file input, false otherwise
+**/
+void snapshot_print(HashADT hashtable, char* handle, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"snapshot\" \"print\" \"%s\"\n", handle);
+  }
+  if(live_snapshot == NULL)
+  {
+    fprintf(stdout, "error: no snapshot has been taken\n");
+    fflush(stdout);
+    return;
+  }
+  // ids are never reused, so a known handle with an id the snapshot covers
+  // was there when it was taken
+  uint32_t id = NO_PERSON;
+  if(ht_has(hashtable, handle) == true)
+  {
+    id = handle_id(hashtable, handle);
+  }
+  if(id == NO_PERSON || id >= live_snapshot->ids)
+  {
+    fprintf(stdout,"error: handle \"%s\" is unknown\n", handle);
+    fflush(stdout);
+    return;
+  }
+  if(compressed_adjacency == false)
+  {
+    print_friends(handle, names_by_id[id], adjacency + live_snapshot->offsets[id],
+                  live_snapshot->friend_counts[id], live_snapshot->max_friends[id]);
+    return;
+  }
+  size_t count = live_snapshot->friend_counts[id];
+  uint32_t* ids = malloc(sizeof(uint32_t) * (count + 1));
+  assert(ids != NULL);
+  varint_decode(live_snapshot->packed[id], count, ids);
+  print_friend_count(handle, names_by_id[id], count);
+  for(size_t i = 0; i < count; i++)
+  {
+    char* buddy_name;
+    char* buddy_handle = snapshot_handle(ids[i], &buddy_name);
+    printf("\t%s (%s)\n", buddy_handle, buddy_name);
+  }
+  free(ids);
+}
+
+/**
+Prints the friends two people have in common, intersecting their sorted
+friend ids instead of comparing every pair of handles
+@param hashtable: Hashtable containing people
+@param handle1: the handle of one of the people
+@param handle2: the handle of the other person
+@param file: true if command was called from file input, false otherwise
+**/
+void print_mutual(HashADT hashtable, char* handle1, char* handle2, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"mutual\" \"%s\" \"%s\"\n", handle1, handle2);
+  }
+  if(ht_has(hashtable, handle1) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle1);
+    fflush(stdout);
+  }
+  else if(ht_has(hashtable, handle2) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle2);
+    fflush(stdout);
+  }
+  else if(strcmp(handle1, handle2) == 0)
+  {
+    fprintf(stdout, "error: \"%s\" and \"%s\" are the same person\n", handle1, handle2);
+    fflush(stdout);
+  }
+  else
+  {
+    uint32_t id1 = handle_id(hashtable, handle1);
+    uint32_t id2 = handle_id(hashtable, handle2);
+    id_buffer_t buffer1 = {NULL, 0};
+    id_buffer_t buffer2 = {NULL, 0};
+    const uint32_t* friends1 = sorted_friend_ids(id1, &buffer1);
+    const uint32_t* friends2 = sorted_friend_ids(id2, &buffer2);
+    size_t count1 = friend_counts_by_id[id1];
+    size_t count2 = friend_counts_by_id[id2];
+    size_t smaller = count1 < count2 ? count1 : count2;
+    uint32_t* common = malloc(sizeof(uint32_t) * (smaller + 1));
+    assert(common != NULL);
+    size_t count = intersect_sorted(friends1, count1, friends2, count2, common);
+    if(count > 1)
+    {
+      printf("%s and %s have %ld mutual friends\n", handle1, handle2, count);
+    }
+    else if(count == 1)
+    {
+      printf("%s and %s have 1 mutual friend\n", handle1, handle2);
+    }
+    else
+    {
+      printf("%s and %s have no mutual friends\n", handle1, handle2);
+    }
+    for(size_t i = 0; i < count; i++)
+    {
+      printf("\t%s (%s)\n", handles_by_id[common[i]], names_by_id[common[i]]);
+    }
+    free(common);
+    free(buffer1.ids);
+    free(buffer2.ids);
+  }
+}
+
+/**
+Orders two suggestions, fewer mutual friends first and then the later id
+@param id1: the id of the first candidate
+@param id2: the id of the second candidate
+@return true if id1 is a worse suggestion than id2
+**/
+static bool worse_suggestion(uint32_t id1, uint32_t id2)
+{
+  if(suggest_counts[id1] != suggest_counts[id2])
+  {
+    return(suggest_counts[id1] < suggest_counts[id2]);
+  }
+  return(id1 > id2);
+}
+
+/**
+Restores the min-heap order of the suggestion heap below a position
+@param heap: the heap of candidate ids, worst suggestion first
+@param length: the number of ids in the heap
+@param position: the position that may be out of order
+**/
+static void sift_down_suggestion(uint32_t* heap, size_t length, size_t position)
+{
+  while(true)
+  {
+    size_t worst = position;
+    size_t left = position * 2 + 1;
+    size_t right = left + 1;
+    if(left < length && worse_suggestion(heap[left], heap[worst]) == true)
+    {
+      worst = left;
+    }
+    if(right < length && worse_suggestion(heap[right], heap[worst]) == true)
+    {
+      worst = right;
+    }
+    if(worst == position)
+    {
+      return;
+    }
+    uint32_t swap = heap[position];
+    heap[position] = heap[worst];
+    heap[worst] = swap;
+    position = worst;
+  }
+}
+
+/**
+Counts the friends of some of a persons friends, for a suggest worker.
+Friends are read where they are stored, without merging tails or building
+sorted ids, so the workers leave every person as it was
+@param first: the position of the first friend to walk
+@param last: one past the position of the last friend to walk
+@param arg: the sorted ids of the persons friends
+@param worker: the number of the worker, which picks its shard
+**/
+static void count_suggestions(size_t first, size_t last, void *arg, unsigned worker)
+{
+  const uint32_t* friends = (const uint32_t*)arg;
+  suggest_shard_t* shard = &suggest_shards[worker];
+  for(size_t i = first; i < last; i++)
+  {
+    friend_iter_t iter;
+    friend_iter_start(&iter, friends[i]);
+    for(uint32_t second = friend_iter_next(&iter); second != NO_PERSON; second = friend_iter_next(&iter))
+    {
+      if(shard->counts[second] == 0)
+      {
+        shard->touched[shard->touched_length] = second;
+        shard->touched_length+=1;
+      }
+      shard->counts[second]+=1;
+    }
+  }
+}
+
+/**
+Makes sure a suggest worker has counts for every id
+@param shard: the shard of the worker
+**/
+static void grow_suggest_shard(suggest_shard_t* shard)
+{
+  if(shard->capacity < people_count)
+  {
+    shard->counts = mem_realloc(MEM_INDEXES, shard->counts, sizeof(uint32_t) * people_count);
+    shard->touched = mem_realloc(MEM_INDEXES, shard->touched, sizeof(uint32_t) * people_count);
+    assert(shard->counts != NULL && shard->touched != NULL);
+    memset(shard->counts + shard->capacity, 0, sizeof(uint32_t) * (people_count - shard->capacity));
+    shard->capacity = people_count;
+  }
+}
+
+/**
+Prints the k people who are not yet friends with a person but share the
+most friends with them. Friends of friends are counted in a dense array
+indexed by id and the best k are kept in a min-heap of size k. When there
+are many friends of friends the walk is split across the parallel workers,
+each counting into its own array, and the counts are added up after
+@param hashtable: Hashtable containing people
+@param handle: the handle of the person
+@param amount: the number of suggestions wanted, as typed
+@param file: true if command was called from file input, false otherwise
+**/
+void print_suggestions(HashADT hashtable, char* handle, char* amount, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"suggest\" \"%s\" \"%s\"\n", handle, amount);
+  }
+  char* end = NULL;
+  long k = strtol(amount, &end, 10);
+  if(ht_has(hashtable, handle) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle);
+    fflush(stdout);
+    return;
+  }
+  else if(*end != '\0' || k <= 0)
+  {
+    fprintf(stdout,"error: argument \"%s\" is invalid\n", amount);
+    fflush(stdout);
+    return;
+  }
+  suggest_shards[0].counts = suggest_counts;
+  suggest_shards[0].touched = suggest_touched;
+  suggest_shards[0].capacity = suggest_capacity;
+  grow_suggest_shard(&suggest_shards[0]);
+  suggest_counts = suggest_shards[0].counts;
+  suggest_touched = suggest_shards[0].touched;
+  suggest_capacity = suggest_shards[0].capacity;
+  uint32_t id = handle_id(hashtable, handle);
+  id_buffer_t buffer = {NULL, 0};
+  const uint32_t* friends = sorted_friend_ids(id, &buffer);
+  size_t friend_count = friend_counts_by_id[id];
+  size_t walk = 0;
+  for(size_t i = 0; i < friend_count; i++)
+  {
+    walk+=friend_counts_by_id[friends[i]];
+  }
+  unsigned workers = walk >= SUGGEST_PARALLEL_MIN ? parallel_threads() : 1;
+  for(unsigned w = 0; w < workers; w++)
+  {
+    grow_suggest_shard(&suggest_shards[w]);
+    suggest_shards[w].touched_length = 0;
+  }
+  if(workers == 1)
+  {
+    count_suggestions(0, friend_count, (void*)friends, 0);
+  }
+  else
+  {
+    parallel_for(friend_count, parallel_chunk(friend_count), count_suggestions, (void*)friends);
+  }
+  size_t touched = suggest_shards[0].touched_length;
+  for(unsigned w = 1; w < workers; w++)
+  {
+    suggest_shard_t* shard = &suggest_shards[w];
+    for(size_t i = 0; i < shard->touched_length; i++)
+    {
+      uint32_t id = shard->touched[i];
+      if(suggest_counts[id] == 0)
+      {
+        suggest_touched[touched] = id;
+        touched+=1;
+      }
+      suggest_counts[id]+=shard->counts[id];
+      shard->counts[id] = 0;
+    }
+    shard->touched_length = 0;
+  }
+  // the person and their friends are not candidates, forget their counts
+  suggest_counts[id] = 0;
+  for(size_t i = 0; i < friend_count; i++)
+  {
+    suggest_counts[friends[i]] = 0;
+  }
+  size_t limit = (size_t)k < touched ? (size_t)k : touched;
+  uint32_t* heap = malloc(sizeof(uint32_t) * (limit + 1));
+  assert(heap != NULL);
+  size_t length = 0;
+  for(size_t i = 0; i < touched; i++)
+  {
+    uint32_t candidate = suggest_touched[i];
+    if(suggest_counts[candidate] == 0)
+    {
+      continue;
+    }
+    if(length < limit)
+    {
+      heap[length] = candidate;
+      length+=1;
+      if(length == limit)
+      {
+        for(size_t j = limit / 2 + 1; j > 0; j--)
+        {
+          sift_down_suggestion(heap, length, j - 1);
+        }
+      }
+    }
+    else if(worse_suggestion(heap[0], candidate) == true)
+    {
+      heap[0] = candidate;
+      sift_down_suggestion(heap, length, 0);
+    }
+  }
+  if(length < limit)
+  {
+    for(size_t j = length / 2 + 1; j > 0; j--)
+    {
+      sift_down_suggestion(heap, length, j - 1);
+    }
+  }
+  // pop the worst suggestion to the back until the heap is sorted best first
+  for(size_t end_of_heap = length; end_of_heap > 1; end_of_heap--)
+  {
+    uint32_t swap = heap[0];
+    heap[0] = heap[end_of_heap - 1];
+    heap[end_of_heap - 1] = swap;
+    sift_down_suggestion(heap, end_of_heap - 1, 0);
+  }
+  if(length > 1)
+  {
+    printf("%s (%s) has %ld suggestions\n", handle, names_by_id[id], length);
+  }
+  else if(length == 1)
+  {
+    printf("%s (%s) has 1 suggestion\n", handle, names_by_id[id]);
+  }
+  else
+  {
+    printf("%s (%s) has no suggestions\n", handle, names_by_id[id]);
+  }
+  for(size_t i = 0; i < length; i++)
+  {
+    uint32_t suggestion = heap[i];
+    if(suggest_counts[suggestion] == 1)
+    {
+      printf("\t%s (%s), 1 mutual friend\n", handles_by_id[suggestion], names_by_id[suggestion]);
+    }
+    else
+    {
+      printf("\t%s (%s), %u mutual friends\n", handles_by_id[suggestion], names_by_id[suggestion], suggest_counts[suggestion]);
+    }
+  }
+  for(size_t i = 0; i < touched; i++)
+  {
+    suggest_counts[suggest_touched[i]] = 0;
+  }
+  free(heap);
+  free(buffer.ids);
+}
+
+/**
+Tells whether an id is set in a bitmap
+@param bitmap: the bitmap
+@param id: the id to test
+@return true if the bit for id is set
+**/
+static bool bit_test(const uint64_t* bitmap, uint32_t id)
+{
+  return((bitmap[id / 64] >> (id % 64)) & 1);
+}
+
+/**
+Sets the bit for an id in a bitmap
+@param bitmap: the bitmap
+@param id: the id to set
+**/
+static void bit_set(uint64_t* bitmap, uint32_t id)
+{
+  bitmap[id / 64]|=(uint64_t)1 << (id % 64);
+}
+
+/**
+Records that a search side reached an id, and whether the other side had
+already reached it
+@param side: the side doing the reaching
+@param other: the opposite side of the search
+@param id: the id reached
+@param parent: the id it was reached from
+@return true if both sides have now reached id
+**/
+static bool reach(search_side_t* side, search_side_t* other, uint32_t id, uint32_t parent)
+{
+  bit_set(side->visited, id);
+  side->parent[id] = parent;
+  side->next[side->next_length] = id;
+  side->next_length+=1;
+  side->unexplored_friends-=friend_counts_by_id[id];
+  return(bit_test(other->visited, id));
+}
+
+/**
+Expands one level of a search side. The level is pushed top-down from the
+frontier while it is small, and pulled bottom-up by scanning the ids not yet
+reached for a friend in the frontier once it is large. Friends are read
+where they are stored, so a level neither merges tails nor builds sorted ids
+for the people it scans
+@param side: the side to expand
+@param other: the opposite side of the search
+@param in_frontier: an all clear bitmap to mark the frontier in
+@param meeting: receives the id both sides reached, if any
+@return true if the sides met
+**/
+static bool expand_level(search_side_t* side, search_side_t* other, uint64_t* in_frontier, uint32_t* meeting)
+{
+  bool met = false;
+  side->next_length = 0;
+  if(side->frontier_friends > side->unexplored_friends / BOTTOM_UP_DIVISOR)
+  {
+    for(size_t i = 0; i < side->frontier_length; i++)
+    {
+      bit_set(in_frontier, side->frontier[i]);
+    }
+    for(size_t word = 0; word * 64 < people_count && met == false; word++)
+    {
+      if(side->visited[word] == UINT64_MAX)
+      {
+        continue;
+      }
+      for(uint32_t id = word * 64; id < (word + 1) * 64 && id < people_count; id++)
+      {
+        if(bit_test(side->visited, id) == true)
+        {
+          continue;
+        }
+        if(handles_by_id[id] == NULL)
+        {
+          continue;
+        }
+        friend_iter_t iter;
+        friend_iter_start(&iter, id);
+        for(uint32_t buddy = friend_iter_next(&iter); buddy != NO_PERSON; buddy = friend_iter_next(&iter))
+        {
+          if(bit_test(in_frontier, buddy) == true)
+          {
+            if(reach(side, other, id, buddy) == true)
+            {
+              *meeting = id;
+              met = true;
+            }
+            break;
+          }
+        }
+        if(met == true)
+        {
+          break;
+        }
+      }
+    }
+    for(size_t i = 0; i < side->frontier_length; i++)
+    {
+      in_frontier[side->frontier[i] / 64] = 0;
+    }
+  }
+  else
+  {
+    for(size_t i = 0; i < side->frontier_length && met == false; i++)
+    {
+      uint32_t id = side->frontier[i];
+      friend_iter_t iter;
+      friend_iter_start(&iter, id);
+      for(uint32_t buddy = friend_iter_next(&iter); buddy != NO_PERSON; buddy = friend_iter_next(&iter))
+      {
+        if(bit_test(side->visited, buddy) == false)
+        {
+          if(reach(side, other, buddy, id) == true)
+          {
+            *meeting = buddy;
+            met = true;
+            break;
+          }
+        }
+      }
+    }
+  }
+  uint32_t* swap = side->frontier;
+  side->frontier = side->next;
+  side->next = swap;
+  side->frontier_length = side->next_length;
+  side->frontier_friends = 0;
+  for(size_t i = 0; i < side->frontier_length; i++)
+  {
+    side->frontier_friends+=friend_counts_by_id[side->frontier[i]];
+  }
+  return(met);
+}
+
+/**
+Starts one side of a search at a person
+@param side: the side to set up
+@param start: the id the side starts from
+@param words: the number of 64 bit words in a bitmap over all ids
+**/
+static void start_side(search_side_t* side, uint32_t start, size_t words)
+{
+  side->visited = calloc(words, sizeof(uint64_t));
+  side->parent = malloc(sizeof(uint32_t) * people_count);
+  side->frontier = malloc(sizeof(uint32_t) * people_count);
+  side->next = malloc(sizeof(uint32_t) * people_count);
+  assert(side->visited != NULL && side->parent != NULL && side->frontier != NULL && side->next != NULL);
+  bit_set(side->visited, start);
+  side->parent[start] = NO_PARENT;
+  side->frontier[0] = start;
+  side->frontier_length = 1;
+  side->frontier_friends = friend_counts_by_id[start];
+  side->unexplored_friends = total_friendships * 2 - friend_counts_by_id[start];
+}
+
+/**
+Frees the storage of one side of a search
+@param side: the side to free
+**/
+static void free_side(search_side_t* side)
+{
+  free(side->visited);
+  free(side->parent);
+  free(side->frontier);
+  free(side->next);
+}
+
+/**
+Prints the shortest chain of friendships between two people, found with a
+breadth first search from both ends that always expands the smaller side
+@param hashtable: Hashtable containing people
+@param handle1: the handle of one of the people
+@param handle2: the handle of the other person
+@param file: true if command was called from file input, false otherwise
+**/
+void print_path(HashADT hashtable, char* handle1, char* handle2, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"path\" \"%s\" \"%s\"\n", handle1, handle2);
+  }
+  if(ht_has(hashtable, handle1) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle1);
+    fflush(stdout);
+    return;
+  }
+  else if(ht_has(hashtable, handle2) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle2);
+    fflush(stdout);
+    return;
+  }
+  else if(strcmp(handle1, handle2) == 0)
+  {
+    fprintf(stdout, "error: \"%s\" and \"%s\" are the same person\n", handle1, handle2);
+    fflush(stdout);
+    return;
+  }
+  uint32_t id1 = handle_id(hashtable, handle1);
+  uint32_t id2 = handle_id(hashtable, handle2);
+  size_t words = (people_count + 63) / 64;
+  search_side_t from;
+  search_side_t to;
+  start_side(&from, id1, words);
+  start_side(&to, id2, words);
+  uint64_t* in_frontier = calloc(words, sizeof(uint64_t));
+  assert(in_frontier != NULL);
+  uint32_t meeting = NO_PARENT;
+  bool met = false;
+  while(met == false && from.frontier_length > 0 && to.frontier_length > 0)
+  {
+    if(from.frontier_friends <= to.frontier_friends)
+    {
+      met = expand_level(&from, &to, in_frontier, &meeting);
+    }
+    else
+    {
+      met = expand_level(&to, &from, in_frontier, &meeting);
+    }
+  }
+  if(met == false)
+  {
+    printf("%s and %s are not connected\n", handle1, handle2);
+  }
+  else
+  {
+    // walk back to handle1 to order the first half, then on to handle2
+    size_t length = 0;
+    uint32_t* chain = from.frontier;
+    for(uint32_t id = meeting; id != NO_PARENT; id = from.parent[id])
+    {
+      chain[length] = id;
+      length+=1;
+    }
+    for(size_t i = 0; i < length / 2; i++)
+    {
+      uint32_t swap = chain[i];
+      chain[i] = chain[length - 1 - i];
+      chain[length - 1 - i] = swap;
+    }
+    for(uint32_t id = to.parent[meeting]; id != NO_PARENT; id = to.parent[id])
+    {
+      chain[length] = id;
+      length+=1;
+    }
+    if(length == 2)
+    {
+      printf("%s and %s are 1 friendship apart\n", handle1, handle2);
+    }
+    else
+    {
+      printf("%s and %s are %ld friendships apart\n", handle1, handle2, length - 1);
+    }
+    for(size_t i = 0; i < length; i++)
+    {
+      printf("\t%s (%s)\n", handles_by_id[chain[i]], names_by_id[chain[i]]);
+    }
+  }
+  free(in_frontier);
+  free_side(&from);
+  free_side(&to);
+}
+
+/**
+Brings the groups up to date with the unfriendings since the last refresh.
+Only the groups holding an unfriended pair are rebuilt: each of their people
+is reached by a search from one of the pairs and hung directly under the
+id the search started from, the rest of the forest is left alone
+**/
+static void refresh_components(void)
+{
+  if(dirty_length == 0)
+  {
+    return;
+  }
+  uint64_t* relabeled = calloc((people_count + 63) / 64, sizeof(uint64_t));
+  uint32_t* queue = malloc(sizeof(uint32_t) * people_count);
+  assert(relabeled != NULL && queue != NULL);
+  id_buffer_t buffer = {NULL, 0};
+  // every old group that held an unfriended pair is about to be recounted
+  for(size_t i = 0; i < dirty_length; i++)
+  {
+    uint32_t root = find_component(dirty_pairs[i]);
+    if(bit_test(relabeled, root) == false)
+    {
+      bit_set(relabeled, root);
+      component_count-=1;
+    }
+  }
+  memset(relabeled, 0, sizeof(uint64_t) * ((people_count + 63) / 64));
+  for(size_t i = 0; i < dirty_length; i++)
+  {
+    uint32_t start = dirty_pairs[i];
+    if(bit_test(relabeled, start) == true)
+    {
+      continue;
+    }
+    bit_set(relabeled, start);
+    component_parent[start] = start;
+    component_rank[start] = 0;
+    component_count+=1;
+    size_t head = 0;
+    size_t tail = 0;
+    queue[tail] = start;
+    tail+=1;
+    while(head < tail)
+    {
+      uint32_t id = queue[head];
+      head+=1;
+      const uint32_t* friends = sorted_friend_ids(id, &buffer);
+      size_t friend_count = friend_counts_by_id[id];
+      for(size_t j = 0; j < friend_count; j++)
+      {
+        if(bit_test(relabeled, friends[j]) == false)
+        {
+          bit_set(relabeled, friends[j]);
+          component_parent[friends[j]] = start;
+          component_rank[friends[j]] = 0;
+          component_rank[start] = 1;
+          queue[tail] = friends[j];
+          tail+=1;
+        }
+      }
+    }
+  }
+  free(relabeled);
+  free(queue);
+  free(buffer.ids);
+  dirty_length = 0;
+}
+
+/**
+Prints the number of connected groups of people
+@param file: true if command was called from file input, false otherwise
+**/
+void print_components(bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"components\"\n");
+  }
+  refresh_components();
+  if(component_count == 0)
+  {
+    printf("Components:  no groups\n");
+  }
+  else if(component_count == 1)
+  {
+    printf("Components:  1 group\n");
+  }
+  else
+  {
+    printf("Components:  %ld groups\n", component_count);
+  }
+}
+
+/**
+Prints whether two people are linked by any chain of friendships
+@param hashtable: Hashtable containing people
+@param handle1: the handle of one of the people
+@param handle2: the handle of the other person
+@param file: true if command was called from file input, false otherwise
+**/
+void print_connected(HashADT hashtable, char* handle1, char* handle2, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"connected\" \"%s\" \"%s\"\n", handle1, handle2);
+  }
+  if(ht_has(hashtable, handle1) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle1);
+    fflush(stdout);
+  }
+  else if(ht_has(hashtable, handle2) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle2);
+    fflush(stdout);
+  }
+  else if(strcmp(handle1, handle2) == 0)
+  {
+    fprintf(stdout, "error: \"%s\" and \"%s\" are the same person\n", handle1, handle2);
+    fflush(stdout);
+  }
+  else
+  {
+    uint32_t id1 = handle_id(hashtable, handle1);
+    uint32_t id2 = handle_id(hashtable, handle2);
+    refresh_components();
+    if(find_component(id1) == find_component(id2))
+    {
+      printf("%s and %s are connected\n", handle1, handle2);
+    }
+    else
+    {
+      printf("%s and %s are not connected\n", handle1, handle2);
+    }
+  }
+}
+
+/**
+Compares two ids by the friend count of their people, then by id, for qsort
+@param id1: pointer to the first id
+@param id2: pointer to the second id
+@return negative, zero or positive as id1 ranks below, equal or above id2
+**/
+static int compare_degrees(const void *id1, const void *id2)
+{
+  uint32_t first = *(const uint32_t*)id1;
+  uint32_t second = *(const uint32_t*)id2;
+  size_t first_degree = friend_counts_by_id[first];
+  size_t second_degree = friend_counts_by_id[second];
+  if(first_degree != second_degree)
+  {
+    return (first_degree > second_degree) - (first_degree < second_degree);
+  }
+  return (first > second) - (first < second);
+}
+
+/**
+Brings forward_graph and triangle_count up to date with the graph. Vertices
+are numbered by rank in increasing friend count and every friendship is kept
+only in the list of its lower ranked end, which keeps the lists of the most
+popular people short
+**/
+static void refresh_triangles(void)
+{
+  if(forward_graph != NULL && forward_version == graph_version)
+  {
+    return;
+  }
+  csr_destroy(forward_graph);
+  uint32_t* order = malloc(sizeof(uint32_t) * (people_count + 1));
+  uint32_t* rank = malloc(sizeof(uint32_t) * (people_count + 1));
+  assert(order != NULL && rank != NULL);
+  size_t live = live_ids(order);
+  qsort(order, live, sizeof(uint32_t), compare_degrees);
+  for(size_t i = 0; i < live; i++)
+  {
+    rank[order[i]] = (uint32_t)i;
+  }
+  csr_t* graph = csr_create(live, total_friendships);
+  id_buffer_t buffer = {NULL, 0};
+  for(size_t r = 0; r < live; r++)
+  {
+    const uint32_t* friends = sorted_friend_ids(order[r], &buffer);
+    size_t friend_count = friend_counts_by_id[order[r]];
+    for(size_t j = 0; j < friend_count; j++)
+    {
+      if(rank[friends[j]] > r)
+      {
+        graph->offsets[r + 1]+=1;
+      }
+    }
+  }
+  for(size_t r = 0; r < live; r++)
+  {
+    graph->offsets[r + 1]+=graph->offsets[r];
+  }
+  // visiting ranks in increasing order appends each list already sorted
+  size_t* filled = malloc(sizeof(size_t) * (live + 1));
+  assert(filled != NULL);
+  memcpy(filled, graph->offsets, sizeof(size_t) * (live + 1));
+  for(size_t r = 0; r < live; r++)
+  {
+    const uint32_t* friends = sorted_friend_ids(order[r], &buffer);
+    size_t friend_count = friend_counts_by_id[order[r]];
+    for(size_t j = 0; j < friend_count; j++)
+    {
+      uint32_t lower = rank[friends[j]];
+      if(lower < r)
+      {
+        graph->targets[filled[lower]] = (uint32_t)r;
+        filled[lower]+=1;
+      }
+    }
+  }
+  free(filled);
+  free(order);
+  free(rank);
+  free(buffer.ids);
+  forward_graph = graph;
+  forward_version = graph_version;
+  triangle_count = csr_count_triangles(forward_graph);
+}
+
+/**
+Prints the number of triangles, groups of three people who are all friends
+@param file: true if command was called from file input, false otherwise
+**/
+void print_triangles(bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"triangles\"\n");
+  }
+  refresh_triangles();
+  if(triangle_count == 0)
+  {
+    printf("Triangles:  no triangles\n");
+  }
+  else if(triangle_count == 1)
+  {
+    printf("Triangles:  1 triangle\n");
+  }
+  else
+  {
+    printf("Triangles:  %lu triangles\n", (unsigned long)triangle_count);
+  }
+}
+
+/**
+Prints how close a persons friends are to being all friends with each other,
+or with no handle, the fraction of connected triples of people that are
+triangles across the whole graph
+@param hashtable: Hashtable containing people
+@param handle: the handle of the person, or NULL for the whole graph
+@param file: true if command was called from file input, false otherwise
+**/
+void print_clustering(HashADT hashtable, char* handle, bool file)
+{
+  if(file == false && handle == NULL)
+  {
+    printf("Amici> + \"clustering\"\n");
+  }
+  else if(file == false)
+  {
+    printf("Amici> + \"clustering\" \"%s\"\n", handle);
+  }
+  if(handle == NULL)
+  {
+    refresh_triangles();
+    uint64_t triples = 0;
+    for(size_t i = 0; i < people_count; i++)
+    {
+      uint64_t degree = friend_counts_by_id[i];
+      triples+=degree * (degree - (degree > 0)) / 2;
+    }
+    double coefficient = triples == 0 ? 0.0 : 3.0 * (double)triangle_count / (double)triples;
+    printf("Clustering:  %.4f\n", coefficient);
+  }
+  else if(ht_has(hashtable, handle) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle);
+    fflush(stdout);
+  }
+  else
+  {
+    uint32_t id = handle_id(hashtable, handle);
+    id_buffer_t buffer = {NULL, 0};
+    id_buffer_t buddy_buffer = {NULL, 0};
+    const uint32_t* friends = sorted_friend_ids(id, &buffer);
+    size_t friend_count = friend_counts_by_id[id];
+    uint64_t links = 0;
+    for(size_t i = 0; i < friend_count; i++)
+    {
+      links+=intersect_sorted(friends, friend_count, sorted_friend_ids(friends[i], &buddy_buffer), friend_counts_by_id[friends[i]], NULL);
+    }
+    free(buffer.ids);
+    free(buddy_buffer.ids);
+    // every link between two friends was seen from both of its ends
+    links/=2;
+    uint64_t degree = friend_count;
+    double coefficient = degree < 2 ? 0.0 : 2.0 * (double)links / (double)(degree * (degree - 1));
+    printf("%s (%s) has clustering %.4f\n", handle, names_by_id[id], coefficient);
+  }
+}
+
+/**
+Brings rank_graph and page_rank up to date with the graph, running PageRank
+again only when the graph changed or a different tolerance is asked for
+@param tolerance: the total change at which the ranks are converged
+**/
+static void refresh_rank(double tolerance)
+{
+  if(rank_graph != NULL && rank_version == graph_version && rank_tolerance == tolerance)
+  {
+    return;
+  }
+  if(rank_graph == NULL || rank_version != graph_version)
+  {
+    csr_destroy(rank_graph);
+    mem_free(MEM_INDEXES, rank_order);
+    uint32_t* position = malloc(sizeof(uint32_t) * (people_count + 1));
+    rank_order = mem_malloc(MEM_INDEXES, sizeof(uint32_t) * (people_count + 1));
+    assert(position != NULL && rank_order != NULL);
+    size_t live = live_ids(rank_order);
+    qsort(rank_order, live, sizeof(uint32_t), compare_degrees);
+    for(size_t i = 0; i < live / 2; i++)
+    {
+      uint32_t swap = rank_order[i];
+      rank_order[i] = rank_order[live - 1 - i];
+      rank_order[live - 1 - i] = swap;
+    }
+    for(size_t i = 0; i < live; i++)
+    {
+      position[rank_order[i]] = (uint32_t)i;
+    }
+    csr_t* graph = csr_create(live, total_friendships * 2);
+    for(size_t i = 0; i < live; i++)
+    {
+      graph->offsets[i + 1] = graph->offsets[i] + friend_counts_by_id[rank_order[i]];
+    }
+    // visiting positions in increasing order appends each list already sorted
+    size_t* filled = malloc(sizeof(size_t) * (live + 1));
+    assert(filled != NULL);
+    memcpy(filled, graph->offsets, sizeof(size_t) * (live + 1));
+    id_buffer_t buffer = {NULL, 0};
+    for(size_t i = 0; i < live; i++)
+    {
+      const uint32_t* friends = sorted_friend_ids(rank_order[i], &buffer);
+      size_t friend_count = friend_counts_by_id[rank_order[i]];
+      for(size_t j = 0; j < friend_count; j++)
+      {
+        uint32_t neighbor = position[friends[j]];
+        graph->targets[filled[neighbor]] = (uint32_t)i;
+        filled[neighbor]+=1;
+      }
+    }
+    free(filled);
+    free(position);
+    free(buffer.ids);
+    rank_graph = graph;
+    rank_version = graph_version;
+  }
+  mem_free(MEM_INDEXES, page_rank);
+  page_rank = mem_malloc(MEM_INDEXES, sizeof(double) * (rank_graph->vertices + 1));
+  assert(page_rank != NULL);
+  csr_pagerank(rank_graph, RANK_DAMPING, tolerance, RANK_MAX_ITERATIONS, page_rank);
+  rank_tolerance = tolerance;
+}
+
+/**
+Restores the min-heap order of a heap of positions by their page_rank
+@param heap: the heap of positions, lowest rank first
+@param length: the number of positions in the heap
+@param position: the position in the heap that may be out of order
+**/
+static void sift_down_rank(uint32_t* heap, size_t length, size_t position)
+{
+  while(true)
+  {
+    size_t lowest = position;
+    size_t left = position * 2 + 1;
+    size_t right = left + 1;
+    if(left < length && page_rank[heap[left]] < page_rank[heap[lowest]])
+    {
+      lowest = left;
+    }
+    if(right < length && page_rank[heap[right]] < page_rank[heap[lowest]])
+    {
+      lowest = right;
+    }
+    if(lowest == position)
+    {
+      return;
+    }
+    uint32_t swap = heap[position];
+    heap[position] = heap[lowest];
+    heap[lowest] = swap;
+    position = lowest;
+  }
+}
+
+/**
+Prints the k people with the highest PageRank, the most influential people
+@param amount: the number of people wanted, as typed
+@param tolerance: the convergence tolerance as typed, or NULL for the default
+@param file: true if command was called from file input, false otherwise
+**/
+void print_rank(char* amount, char* tolerance, bool file)
+{
+  if(file == false && tolerance == NULL)
+  {
+    printf("Amici> + \"rank\" \"%s\"\n", amount);
+  }
+  else if(file == false)
+  {
+    printf("Amici> + \"rank\" \"%s\" \"%s\"\n", amount, tolerance);
+  }
+  char* end = NULL;
+  long k = strtol(amount, &end, 10);
+  if(*end != '\0' || k <= 0)
+  {
+    fprintf(stdout,"error: argument \"%s\" is invalid\n", amount);
+    fflush(stdout);
+    return;
+  }
+  double converged = RANK_TOLERANCE;
+  if(tolerance != NULL)
+  {
+    converged = strtod(tolerance, &end);
+    if(*end != '\0' || !(converged > 0.0))
+    {
+      fprintf(stdout,"error: argument \"%s\" is invalid\n", tolerance);
+      fflush(stdout);
+      return;
+    }
+  }
+  refresh_rank(converged);
+  size_t people = rank_graph->vertices;
+  size_t limit = (size_t)k < people ? (size_t)k : people;
+  uint32_t* heap = malloc(sizeof(uint32_t) * (limit + 1));
+  assert(heap != NULL);
+  for(size_t i = 0; i < limit; i++)
+  {
+    heap[i] = (uint32_t)i;
+  }
+  for(size_t j = limit / 2 + 1; j > 0; j--)
+  {
+    sift_down_rank(heap, limit, j - 1);
+  }
+  for(size_t i = limit; i < people; i++)
+  {
+    if(page_rank[i] > page_rank[heap[0]])
+    {
+      heap[0] = (uint32_t)i;
+      sift_down_rank(heap, limit, 0);
+    }
+  }
+  // pop the lowest rank to the back until the heap is sorted highest first
+  for(size_t end_of_heap = limit; end_of_heap > 1; end_of_heap--)
+  {
+    uint32_t swap = heap[0];
+    heap[0] = heap[end_of_heap - 1];
+    heap[end_of_heap - 1] = swap;
+    sift_down_rank(heap, end_of_heap - 1, 0);
+  }
+  if(people == 0)
+  {
+    printf("Rank:  no people\n");
+  }
+  else if(people == 1)
+  {
+    printf("Rank:  top 1 of 1 person\n");
+  }
+  else
+  {
+    printf("Rank:  top %ld of %ld people\n", limit, people);
+  }
+  for(size_t i = 0; i < limit; i++)
+  {
+    uint32_t id = rank_order[heap[i]];
+    printf("\t%s (%s) %.6f\n", handles_by_id[id], names_by_id[id], page_rank[heap[i]]);
+  }
+  free(heap);
+}
+
+/**
+Prints the k people with the most friends, walking the degree buckets down
+from the highest friend count
+@param amount: the number of people wanted, as typed
+@param file: true if command was called from file input, false otherwise
+**/
+void print_top(char* amount, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"top\" \"%s\"\n", amount);
+  }
+  char* end = NULL;
+  long k = strtol(amount, &end, 10);
+  if(*end != '\0' || k <= 0)
+  {
+    fprintf(stdout,"error: argument \"%s\" is invalid\n", amount);
+    fflush(stdout);
+    return;
+  }
+  size_t limit = (size_t)k < size_of_hashtable ? (size_t)k : size_of_hashtable;
+  if(size_of_hashtable == 0)
+  {
+    printf("Top:  no people\n");
+    return;
+  }
+  else if(size_of_hashtable == 1)
+  {
+    printf("Top:  1 of 1 person\n");
+  }
+  else
+  {
+    printf("Top:  %ld of %ld people\n", limit, size_of_hashtable);
+  }
+  size_t shown = 0;
+  for(size_t degree = max_degree + 1; degree > 0 && shown < limit; degree--)
+  {
+    for(uint32_t id = degree_buckets[degree - 1]; id != NO_PERSON && shown < limit; id = degree_next_by_id[id])
+    {
+      if(friend_counts_by_id[id] > 1)
+      {
+        printf("\t%s (%s) has %ld friends\n", handles_by_id[id], names_by_id[id], friend_counts_by_id[id]);
+      }
+      else if(friend_counts_by_id[id] == 1)
+      {
+        printf("\t%s (%s) has 1 friend\n", handles_by_id[id], names_by_id[id]);
+      }
+      else
+      {
+        printf("\t%s (%s) has no friends\n", handles_by_id[id], names_by_id[id]);
+      }
+      shown+=1;
+    }
+  }
+}
+
+/**
+Prints the people whose first or last name starts with a prefix, ignoring
+case, in alphabetical order of the matching name
+@param prefix: the start of the name
+@param amount: the most people to print as typed, or NULL for FIND_LIMIT
+@param file: true if command was called from file input, false otherwise
+**/
+void print_find(char* prefix, char* amount, bool file)
+{
+  if(file == false && amount == NULL)
+  {
+    printf("Amici> + \"find\" \"%s\"\n", prefix);
+  }
+  else if(file == false)
+  {
+    printf("Amici> + \"find\" \"%s\" \"%s\"\n", prefix, amount);
+  }
+  long limit = FIND_LIMIT;
+  if(amount != NULL)
+  {
+    char* end = NULL;
+    limit = strtol(amount, &end, 10);
+    if(*end != '\0' || limit <= 0)
+    {
+      fprintf(stdout,"error: argument \"%s\" is invalid\n", amount);
+      fflush(stdout);
+      return;
+    }
+  }
+  if((size_t)limit > size_of_hashtable)
+  {
+    limit = (long)size_of_hashtable;
+  }
+  // a person can match on both names, so ask for enough to fill the limit
+  uint32_t* matches = malloc(sizeof(uint32_t) * ((size_t)limit * 2 + 1));
+  assert(matches != NULL);
+  size_t found = 0;
+  if(name_index != NULL)
+  {
+    found = trie_find(name_index, prefix, matches, (size_t)limit * 2);
+  }
+  size_t unique = 0;
+  for(size_t i = 0; i < found && unique < (size_t)limit; i++)
+  {
+    bool seen = false;
+    for(size_t j = 0; j < unique; j++)
+    {
+      if(matches[j] == matches[i])
+      {
+        seen = true;
+        break;
+      }
+    }
+    if(seen == false)
+    {
+      matches[unique] = matches[i];
+      unique+=1;
+    }
+  }
+  if(unique > 1)
+  {
+    printf("Found:  %ld people\n", unique);
+  }
+  else if(unique == 1)
+  {
+    printf("Found:  1 person\n");
+  }
+  else
+  {
+    printf("Found:  no people\n");
+  }
+  for(size_t i = 0; i < unique; i++)
+  {
+    printf("\t%s (%s)\n", handles_by_id[matches[i]], names_by_id[matches[i]]);
+  }
+  free(matches);
+}
+
+/**
+Publishes the people and friendships as a new version of a shared memory
+image, which read replicas started with -r name switch to on their next
+command. People are numbered by id and keep their friends in print order
+@param name: the name of the image
+@param file: true if command was called from file input, false otherwise
+**/
+void publish_image(char* name, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"publish\" \"%s\"\n", name);
+  }
+  if(image_name_valid(name) == false)
+  {
+    fprintf(stdout,"error: argument \"%s\" is invalid\n", name);
+    fflush(stdout);
+    return;
+  }
+  uint32_t* numbers = malloc(sizeof(uint32_t) * (people_count + 1));
+  assert(numbers != NULL);
+  size_t people = 0;
+  size_t friend_entries = 0;
+  size_t string_bytes = 0;
+  for(size_t i = 0; i < people_count; i++)
+  {
+    if(handles_by_id[i] != NULL)
+    {
+      numbers[i] = (uint32_t)people;
+      people+=1;
+      friend_entries+=friend_counts_by_id[i];
+      string_bytes+=strlen(handles_by_id[i]) + 1 + strlen(names_by_id[i]) + 1;
+    }
+  }
+  // keep the table at most half full so misses stop early
+  size_t slot_count = 16;
+  while(slot_count < people * 2)
+  {
+    slot_count*=2;
+  }
+  size_t persons_offset = sizeof(image_header_t);
+  size_t slots_offset = persons_offset + sizeof(image_person_t) * people;
+  size_t friends_offset = slots_offset + sizeof(uint32_t) * slot_count;
+  size_t strings_offset = friends_offset + sizeof(uint32_t) * friend_entries;
+  image_header_t* image = image_begin(name, strings_offset + string_bytes);
+  if(image == NULL)
+  {
+    free(numbers);
+    fprintf(stdout, "error: image \"%s\" cannot be created\n", name);
+    fflush(stdout);
+    return;
+  }
+  image->people = people;
+  image->friendships = total_friendships;
+  image->slot_count = slot_count;
+  image->persons = persons_offset;
+  image->slots = slots_offset;
+  image->friends = friends_offset;
+  image->strings = strings_offset;
+  image_person_t* persons = (image_person_t*)((char*)image + persons_offset);
+  uint32_t* slots = (uint32_t*)((char*)image + slots_offset);
+  uint32_t* friends = (uint32_t*)((char*)image + friends_offset);
+  char* strings = (char*)image + strings_offset;
+  size_t friend_at = 0;
+  size_t string_at = 0;
+  for(size_t i = 0; i < people_count; i++)
+  {
+    char* handle = handles_by_id[i];
+    if(handle == NULL)
+    {
+      continue;
+    }
+    image_person_t* entry = &persons[numbers[i]];
+    entry->handle = string_at;
+    strcpy(strings + string_at, handle);
+    string_at+=strlen(handle) + 1;
+    entry->name = string_at;
+    strcpy(strings + string_at, names_by_id[i]);
+    string_at+=strlen(names_by_id[i]) + 1;
+    entry->first_friend = friend_at;
+    entry->friend_count = friend_counts_by_id[i];
+    friend_iter_t iter;
+    friend_iter_start(&iter, (uint32_t)i);
+    for(uint32_t buddy = friend_iter_next(&iter); buddy != NO_PERSON; buddy = friend_iter_next(&iter))
+    {
+      friends[friend_at] = numbers[buddy];
+      friend_at+=1;
+    }
+    size_t slot = image_hash(handle) & (slot_count - 1);
+    while(slots[slot] != 0)
+    {
+      slot = (slot + 1) & (slot_count - 1);
+    }
+    slots[slot] = numbers[i] + 1;
+  }
+  free(numbers);
+  uint64_t generation = image->generation;
+  size_t bytes = image->bytes;
+  if(image_publish(name, image) == false)
+  {
+    fprintf(stdout, "error: image \"%s\" cannot be published\n", name);
+    fflush(stdout);
+    return;
+  }
+  printf("Published %s version %lu: %ld bytes\n", name, (unsigned long)generation, bytes);
+}
+
+//bytes in each buffer export formats into
+#define EXPORT_BUFFER_SIZE (256 * 1024)
+//number of buffers export fills before writing them all with one writev
+#define EXPORT_BUFFERS 16
+
+/// The file the export command writes and the buffers waiting to go to it
+typedef struct export_out_s {
+    int fd;     //the file written
+    char *buffers[EXPORT_BUFFERS];     //text formatted but not yet written
+    size_t current;     //the buffer being filled
+    size_t used;     //bytes of the current buffer filled
+    bool failed;     //a write failed, later output is dropped
+} export_out_t;
+
+/**
+Writes every filled buffer to the export file with writev, carrying on
+after short writes, then starts filling the first buffer again
+@param out: the export
+**/
+static void export_flush(export_out_t* out)
+{
+  struct iovec pieces[EXPORT_BUFFERS];
+  int count = 0;
+  for(size_t i = 0; i <= out->current; i++)
+  {
+    size_t length = i == out->current ? out->used : EXPORT_BUFFER_SIZE;
+    if(length > 0)
+    {
+      pieces[count].iov_base = out->buffers[i];
+      pieces[count].iov_len = length;
+      count+=1;
+    }
+  }
+  struct iovec* piece = pieces;
+  while(count > 0 && out->failed == false)
+  {
+    ssize_t written = writev(out->fd, piece, count);
+    if(written < 0)
+    {
+      out->failed = errno != EINTR;
+      continue;
+    }
+    while(count > 0 && (size_t)written >= piece->iov_len)
+    {
+      written-=(ssize_t)piece->iov_len;
+      piece+=1;
+      count-=1;
+    }
+    if(count > 0)
+    {
+      piece->iov_base = (char*)piece->iov_base + written;
+      piece->iov_len-=(size_t)written;
+    }
+  }
+  out->current = 0;
+  out->used = 0;
+}
+
+/**
+Copies text into the export buffers, writing them out once all are full
+@param out: the export
+@param text: the text
+@param length: the number of bytes of text
+**/
+static void export_append(export_out_t* out, const char* text, size_t length)
+{
+  while(length > 0)
+  {
+    if(out->used == EXPORT_BUFFER_SIZE)
+    {
+      if(out->current + 1 == EXPORT_BUFFERS)
+      {
+        export_flush(out);
+      }
+      else
+      {
+        out->current+=1;
+        out->used = 0;
+      }
+    }
+    size_t room = EXPORT_BUFFER_SIZE - out->used;
+    size_t take = length < room ? length : room;
+    memcpy(out->buffers[out->current] + out->used, text, take);
+    out->used+=take;
+    text+=take;
+    length-=take;
+  }
+}
+
+/**
+Writes the whole graph to a file in one walk over the people. An edge list
+has a "handle1 handle2" line for each friendship, written once from the
+person with the lower id. An adjacency list has a "handle: friend ..." line
+for every person, friends in print order, so people without friends are kept
+@param path: the file to write, replaced if it exists
+@param format: "edgelist" or "adjacency", NULL for edgelist
+@param file: true if command was called from file input, false otherwise
+**/
+void export_graph(char* path, char* format, bool file)
+{
+  if(file == false)
+  {
+    if(format == NULL)
+    {
+      printf("Amici> + \"export\" \"%s\"\n", path);
+    }
+    else
+    {
+      printf("Amici> + \"export\" \"%s\" \"%s\"\n", path, format);
+    }
+  }
+  bool lists = format != NULL && strcasecmp(format, "adjacency") == 0;
+  if(format != NULL && lists == false && strcasecmp(format, "edgelist") != 0)
+  {
+    fprintf(stdout,"error: argument \"%s\" is invalid\n", format);
+    fflush(stdout);
+    return;
+  }
+  export_out_t out;
+  out.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(out.fd < 0)
+  {
+    fprintf(stdout, "error: file \"%s\" cannot be written\n", path);
+    fflush(stdout);
+    return;
+  }
+  for(size_t i = 0; i < EXPORT_BUFFERS; i++)
+  {
+    out.buffers[i] = malloc(EXPORT_BUFFER_SIZE);
+    assert(out.buffers[i] != NULL);
+  }
+  out.current = 0;
+  out.used = 0;
+  out.failed = false;
+  size_t people = 0;
+  size_t edges = 0;
+  for(size_t i = 0; i < people_count && out.failed == false; i++)
+  {
+    char* handle = handles_by_id[i];
+    if(handle == NULL)
+    {
+      continue;
+    }
+    size_t length = strlen(handle);
+    people+=1;
+    if(lists == true)
+    {
+      export_append(&out, handle, length);
+      export_append(&out, ":", 1);
+    }
+    friend_iter_t iter;
+    friend_iter_start(&iter, (uint32_t)i);
+    for(uint32_t buddy = friend_iter_next(&iter); buddy != NO_PERSON; buddy = friend_iter_next(&iter))
+    {
+      if(lists == true)
+      {
+        export_append(&out, " ", 1);
+        export_append(&out, handles_by_id[buddy], strlen(handles_by_id[buddy]));
+      }
+      else if(buddy > i)
+      {
+        export_append(&out, handle, length);
+        export_append(&out, " ", 1);
+        export_append(&out, handles_by_id[buddy], strlen(handles_by_id[buddy]));
+        export_append(&out, "\n", 1);
+        edges+=1;
+      }
+    }
+    if(lists == true)
+    {
+      export_append(&out, "\n", 1);
+    }
+  }
+  export_flush(&out);
+  for(size_t i = 0; i < EXPORT_BUFFERS; i++)
+  {
+    free(out.buffers[i]);
+  }
+  if(close(out.fd) != 0 || out.failed == true)
+  {
+    fprintf(stdout, "error: file \"%s\" cannot be written\n", path);
+    fflush(stdout);
+    return;
+  }
+  if(lists == true)
+  {
+    printf("Exported %zu %s to %s\n", people, people == 1 ? "person" : "people", path);
+  }
+  else
+  {
+    printf("Exported %zu %s to %s\n", edges, edges == 1 ? "friendship" : "friendships", path);
+  }
+}
+
+/**
+Prints how full the print cache is and how often it answered print, or sets
+how many bytes of print output it may hold, 0 turning it off
+@param bytes: the new budget, NULL to print the state of the cache
+@param file: true if command was called from file input, false otherwise
+**/
+void print_cache(char* bytes, bool file)
+{
+  if(file == false)
+  {
+    if(bytes == NULL)
+    {
+      printf("Amici> + \"cache\"\n");
+    }
+    else
+    {
+      printf("Amici> + \"cache\" \"%s\"\n", bytes);
+    }
+  }
+  if(bytes != NULL)
+  {
+    char* end = NULL;
+    unsigned long long budget = strtoull(bytes, &end, 10);
+    if(*end != '\0' || isdigit((unsigned char)bytes[0]) == 0)
+    {
+      fprintf(stdout,"error: argument \"%s\" is invalid\n", bytes);
+      fflush(stdout);
+      return;
+    }
+    print_cache_budget = (size_t)budget;
+    trim_rendered(print_cache_budget);
+    if(print_cache_budget == 0)
+    {
+      printf("Print cache off.\n");
+    }
+    else
+    {
+      printf("Print cache holds up to %ld bytes.\n", print_cache_budget);
+    }
+    return;
+  }
+  printf("Print cache:  %ld of %ld bytes, %ld %s, %ld %s, %ld %s\n", print_cache_bytes,
+         print_cache_budget, print_cache_entries, print_cache_entries == 1 ? "person" : "people",
+         print_cache_hits, print_cache_hits == 1 ? "hit" : "hits",
+         print_cache_misses, print_cache_misses == 1 ? "miss" : "misses");
+}
+
+/**
+Adds up the bytes a person needs for their name, handle and friends, and
+what their friends array wastes
+@param id: the id of the person
+@param used: the bytes of each category actually needed, added to
+@param holes: bytes of empty slots before the last friend, added to
+@param spare: bytes of empty slots after the last friend, added to
+**/
+static void measure_person(uint32_t id, size_t used[MEM_CATEGORIES], size_t* holes, size_t* spare)
+{
+  used[MEM_STRINGS]+=strlen(names_by_id[id]) + 1 + strlen(handles_by_id[id]) + 1;
+  if(compressed_adjacency == true)
+  {
+    const uint8_t* cursor = packed_by_id[id];
+    for(size_t i = 0; i < packed_counts_by_id[id]; i++)
+    {
+      uint32_t gap;
+      cursor = varint_read(cursor, &gap);
+    }
+    used[MEM_FRIENDS]+=(size_t)(cursor - packed_by_id[id]) + sizeof(uint32_t) * tail_counts_by_id[id];
+    return;
+  }
+  size_t slot_bytes = sizeof(uint32_t) * 2;
+  const uint32_t* friends = friends_of(id);
+  size_t end = max_friends_by_id[id];
+  while(end > 0 && friends[end - 1] == NO_FRIEND)
+  {
+    end-=1;
+  }
+  used[MEM_FRIENDS]+=slot_bytes * friend_counts_by_id[id];
+  *holes+=slot_bytes * (end - friend_counts_by_id[id]);
+  *spare+=slot_bytes * (max_friends_by_id[id] - end);
+}
+
+/**
+Prints the bytes used and reserved by each kind of data, what it costs per
+person and per friendship, and how much of the heap is lost to fragmentation
+@param file: true if command was called from file input, false otherwise
+**/
+void print_memory(bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"memory\"\n");
+  }
+  size_t used[MEM_CATEGORIES] = {0};
+  size_t holes = 0;
+  size_t spare = 0;
+  for(size_t i = 0; i < people_count; i++)
+  {
+    if(handles_by_id[i] != NULL)
+    {
+      measure_person((uint32_t)i, used, &holes, &spare);
+    }
+  }
+  for(size_t i = 0; live_snapshot != NULL && i < live_snapshot->ids; i++)
+  {
+    if(live_snapshot->handles[i] != NULL)
+    {
+      used[MEM_STRINGS]+=strlen(live_snapshot->names[i]) + 1 + strlen(live_snapshot->handles[i]) + 1;
+    }
+  }
+  // the arrays of the person store are used as far as the ids still in use
+  if(people_capacity > 0)
+  {
+    used[MEM_PEOPLE] = mem_reserved(MEM_PEOPLE) / people_capacity * size_of_hashtable;
+  }
+  used[MEM_TABLE] = sizeof(void*) * 2 * size_of_hashtable;
+  printf("Memory:  %ld %s, %ld %s\n", size_of_hashtable, size_of_hashtable == 1 ? "person" : "people",
+         total_friendships, total_friendships == 1 ? "friendship" : "friendships");
+  size_t total_used = 0;
+  size_t total_reserved = 0;
+  for(size_t i = 0; i < MEM_CATEGORIES; i++)
+  {
+    size_t reserved = mem_reserved(i);
+    total_reserved+=reserved;
+    if(i == MEM_INDEXES)
+    {
+      printf("\t%s: %ld bytes reserved in %ld %s\n", mem_category_names[i], reserved, mem_blocks(i),
+             mem_blocks(i) == 1 ? "block" : "blocks");
+      continue;
+    }
+    total_used+=used[i];
+    printf("\t%s: %ld bytes used, %ld bytes reserved in %ld %s", mem_category_names[i],
+           used[i], reserved, mem_blocks(i), mem_blocks(i) == 1 ? "block" : "blocks");
+    if(i == MEM_FRIENDS && compressed_adjacency == false)
+    {
+      printf(", %ld bytes in holes, %ld bytes spare", holes, spare);
+    }
+    printf("\n");
+  }
+  printf("\ttotal: %ld bytes used, %ld bytes reserved", total_used, total_reserved);
+  if(total_reserved > 0)
+  {
+    printf(", %.1f%% unused", 100.0 * (double)(total_reserved - total_used) / (double)total_reserved);
+  }
+  printf("\n");
+  if(size_of_hashtable > 0)
+  {
+    size_t per_person = mem_reserved(MEM_TABLE) + mem_reserved(MEM_PEOPLE) + mem_reserved(MEM_STRINGS);
+    printf("\tper person: %.1f bytes", (double)per_person / (double)size_of_hashtable);
+    if(total_friendships > 0)
+    {
+      printf(", per friendship: %.1f bytes", (double)mem_reserved(MEM_FRIENDS) / (double)total_friendships);
+    }
+    printf("\n");
+  }
+  size_t mapped;
+  size_t fallback;
+  if(huge_stats(&mapped, &fallback) == true)
+  {
+    printf("\thuge pages: %ld bytes mapped, %ld bytes on transparent pages in place of hugetlbfs\n",
+           mapped, fallback);
+    // the arena is not part of the heap
+    total_reserved-=mem_reserved(MEM_TABLE) + mem_reserved(MEM_FRIENDS);
+  }
+  size_t allocated;
+  size_t unused;
+  if(mem_heap(&allocated, &unused) == true)
+  {
+    // the rest of the heap is stdio, the name index, graphs built for
+    // queries, snapshots and buffers of commands in progress
+    printf("\theap: %ld bytes allocated, %ld untracked, %ld free inside the heap", allocated,
+           allocated > total_reserved ? allocated - total_reserved : 0, unused);
+    if(allocated + unused > 0)
+    {
+      printf(", %.1f%% fragmentation", 100.0 * (double)unused / (double)(allocated + unused));
+    }
+    printf("\n");
+  }
+}
+
+/**
+Removes a person along with all of their friendships. Every friend is
+reached through the friends array and the slot it records in the friends
+own array, so the cost is the size of the persons array, not of the graph.
+Compressed friends have no slots, so the person is left in the packed ids of
+each friend for compressed_forget to drop later
+@param hashtable: Hashtable containing people
+@param handle: the handle of the person
+@param file: true if command was called from file input, false otherwise
+**/
+void remove_person(HashADT hashtable, char* handle, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"remove\" \"%s\"\n", handle);
+  }
+  if(ht_has(hashtable, handle) == false)
+  {
+    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle);
+    fflush(stdout);
+    return;
+  }
+  uint32_t id = handle_id(hashtable, handle);
+  // settle the groups first so the person's own group is the only one split
+  refresh_components();
+  if(friend_counts_by_id[id] == 0)
+  {
+    component_count-=1;
+  }
+  friend_iter_t iter;
+  friend_iter_start(&iter, id);
+  for(uint32_t buddy = friend_iter_next(&iter); buddy != NO_PERSON; buddy = friend_iter_next(&iter))
+  {
+    sorted_valid_by_id[buddy] = false;
+    versions_by_id[buddy]+=1;
+    friend_counts_by_id[buddy]-=1;
+    move_degree(buddy, friend_counts_by_id[buddy] + 1);
+    mark_component_dirty(buddy, buddy);
+    if(compressed_adjacency == true)
+    {
+      compressed_forget(buddy, id);
+    }
+  }
+  // unsharing a friend may move the arrays, so they are looked up each time
+  for(size_t i = 0; i < max_friends_by_id[id]; i++)
+  {
+    uint32_t buddy = friends_of(id)[i];
+    if(buddy == NO_FRIEND)
+    {
+      continue;
+    }
+    size_t slot = slots_of(id)[i];
+    unshare_friends(buddy);
+    friends_of(buddy)[slot] = NO_FRIEND;
+  }
+  total_friendships-=friend_counts_by_id[id];
+  unlink_degree(id, friend_counts_by_id[id]);
+  char* name = names_by_id[id];
+  char* last_name = strchr(name, ' ');
+  *last_name = '\0';
+  trie_remove(name_index, name, id);
+  trie_remove(name_index, last_name + 1, id);
+  *last_name = ' ';
+  ht_remove(hashtable, handles_by_id[id]);
+  size_of_hashtable-=1;
+  graph_version+=1;
+  printf("%s has been removed.\n", handle);
+  if(live_snapshot != NULL && id < live_snapshot->ids)
+  {
+    // the snapshot still shows the person as a friend of others
+    live_snapshot->names[id] = names_by_id[id];
+    live_snapshot->handles[id] = handles_by_id[id];
+    names_by_id[id] = NULL;
+    handles_by_id[id] = NULL;
+  }
+  free_person(id);
+}
+
+/**
+Frees the arrays of the person store once every person in it is freed, and
+everything else kept about the people: the groups and the caches built by
+queries
+**/
+static void free_indexes(void)
+{
+  parallel_stop();
+  total_friendships = 0;
+  csr_destroy(forward_graph);
+  forward_graph = NULL;
+  csr_destroy(rank_graph);
+  rank_graph = NULL;
+  mem_free(MEM_INDEXES, rank_order);
+  rank_order = NULL;
+  mem_free(MEM_INDEXES, page_rank);
+  page_rank = NULL;
+  if(name_index != NULL)
+  {
+    trie_destroy(name_index);
+    name_index = NULL;
+  }
+  void** store[] = {(void**)&names_by_id, (void**)&handles_by_id, (void**)&friend_counts_by_id,
+                    (void**)&max_friends_by_id, (void**)&offsets_by_id, (void**)&versions_by_id,
+                    (void**)&shared_by_id, (void**)&degree_prev_by_id, (void**)&degree_next_by_id,
+                    (void**)&sorted_by_id, (void**)&sorted_valid_by_id, (void**)&rendered_by_id,
+                    (void**)&packed_by_id, (void**)&packed_counts_by_id, (void**)&tails_by_id,
+                    (void**)&tail_counts_by_id};
+  for(size_t i = 0; i < sizeof(store) / sizeof(store[0]); i++)
+  {
+    mem_free(MEM_PEOPLE, *store[i]);
+    *store[i] = NULL;
+  }
+  mem_free(MEM_FRIENDS, adjacency);
+  mem_free(MEM_FRIENDS, adjacency_slots);
+  adjacency = NULL;
+  adjacency_slots = NULL;
+  adjacency_length = 0;
+  adjacency_capacity = 0;
+  adjacency_garbage = 0;
+  mem_free(MEM_INDEXES, degree_buckets);
+  degree_buckets = NULL;
+  degree_capacity = 0;
+  max_degree = 0;
+  mem_free(MEM_INDEXES, component_parent);
+  mem_free(MEM_INDEXES, component_rank);
+  mem_free(MEM_INDEXES, dirty_pairs);
+  component_parent = NULL;
+  component_rank = NULL;
+  dirty_pairs = NULL;
+  component_count = 0;
+  dirty_length = 0;
+  dirty_capacity = 0;
+  mem_free(MEM_INDEXES, suggest_counts);
+  mem_free(MEM_INDEXES, suggest_touched);
+  suggest_counts = NULL;
+  suggest_touched = NULL;
+  suggest_capacity = 0;
+  // shard 0 is suggest_counts and suggest_touched, freed above
+  for(unsigned w = 1; w < MAX_THREADS; w++)
+  {
+    mem_free(MEM_INDEXES, suggest_shards[w].counts);
+    mem_free(MEM_INDEXES, suggest_shards[w].touched);
+    suggest_shards[w].counts = NULL;
+    suggest_shards[w].touched = NULL;
+    suggest_shards[w].capacity = 0;
+  }
+  mem_free(MEM_INDEXES, batch_rounds);
+  batch_rounds = NULL;
+  batch_capacity = 0;
+  people_count = 0;
+  people_capacity = 0;
+}
+
+/**
+Gets rid of all dynamic allocated memory and the hashtable, and creates a new hashtable
+@param hashtable: Hashtable containing people
+@param file: true if command was called from file input, false otherwise
+**/
+HashADT init(HashADT hashtable, bool file)
+{
+  if(file == false)
+  {
+    printf("Amici> + \"init\"\n");
+  }
+  drop_snapshot();
+  // the handles are the keys of the hashtable, freed here with the people
+  for(uint32_t id = 0; id < people_count; id++)
+  {
+    free_person(id);
+  }
+  ht_destroy(hashtable);
+  hashtable = create_people_table();
+  size_of_hashtable = 0;
+  free_indexes();
+  printf("System re-initialized\n");
+  return(hashtable);
+}
+
+/**
+Gets rid of all dynamic allocated memory and the hashtable and closes the program
+@param hashtable: Hashtable containing people
+**/
+int quit(HashADT hashtable)
+{
+  printf("Amici> + \"quit\"\n");
+  drop_snapshot();
+  if(size_of_hashtable == 0)
+  {
+    free_indexes();
+    ht_destroy(hashtable);
+    return(EXIT_SUCCESS);
+  }
+  else
+  {
+    // the handles are the keys of the hashtable, freed here with the people
+    for(uint32_t id = 0; id < people_count; id++)
+    {
+      free_person(id);
+    }
+    ht_destroy(hashtable);
+    size_of_hashtable = 0;
+    free_indexes();
+    return(EXIT_SUCCESS);
+  }
+}
+
+#ifndef AMICI_NO_PROFILE
+//the commands profiled apart, the last entry collects everything else
+static const char* profile_names[] = {"add", "friend", "unfriend", "remove", "print",
+  "size", "stats", "mutual", "suggest", "path", "components", "connected",
+  "triangles", "clustering", "rank", "top", "find", "snapshot", "profile",
+  "counters", "memory", "publish", "export", "cache", "init", "quit", "other"};
+//the number of entries in profile_names
+#define PROFILE_KINDS (sizeof(profile_names) / sizeof(profile_names[0]))
+//latency in nanoseconds of each kind of command
+histogram_t profile_histograms[PROFILE_KINDS];
+//the file the profile is appended to periodically, empty when not dumping
+char profile_path[4096] = "";
+//nanoseconds between dumps to profile_path
+uint64_t profile_interval = 0;
+//when the profile was last dumped
+uint64_t profile_last_dump = 0;
+//true while hardware counters are attributed to commands and table stages
+bool counters_on = false;
+//number of commands of each kind run while counters were on
+uint64_t counter_calls[PROFILE_KINDS];
+//counts summed over each kind of command, including its table stages
+uint64_t counter_totals[PROFILE_KINDS][PERF_COUNTERS];
+//number of table probes and resizes counted, indexed by ht_stage_t
+uint64_t stage_calls[2];
+//counts summed over table probes and resizes, indexed by ht_stage_t
+uint64_t stage_totals[2][PERF_COUNTERS];
+//the counters as the current table stage started
+uint64_t stage_start[PERF_COUNTERS];
+
+/**
+Gets the monotonic clock, which clock_gettime reads without a system call
+@return the time in nanoseconds
+**/
+static uint64_t profile_now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return((uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec);
+}
+
+/**
+Finds which histogram a command is profiled in
+@param command: the first word of the command
+@return the index into profile_names
+**/
+static size_t profile_kind(const char* command)
+{
+  for(size_t i = 0; i < PROFILE_KINDS - 1; i++)
+  {
+    if(strcasecmp(command, profile_names[i]) == 0)
+    {
+      return(i);
+    }
+  }
+  return(PROFILE_KINDS - 1);
+}
+
+/**
+Writes the count and latency percentiles of every command run so far
+@param out: where to write
+**/
+static void profile_write(FILE* out)
+{
+  uint64_t commands = 0;
+  for(size_t i = 0; i < PROFILE_KINDS; i++)
+  {
+    commands+=profile_histograms[i].count;
+  }
+  if(commands == 1)
+  {
+    fprintf(out, "Profile: 1 command\n");
+  }
+  else
+  {
+    fprintf(out, "Profile: %lu commands\n", (unsigned long)commands);
+  }
+  for(size_t i = 0; i < PROFILE_KINDS; i++)
+  {
+    const histogram_t* histogram = &profile_histograms[i];
+    if(histogram->count == 0)
+    {
+      continue;
+    }
+    fprintf(out, "\t%s: %lu %s, %.3f ms total, p50 %lu ns, p99 %lu ns, p999 %lu ns, max %lu ns\n",
+            profile_names[i], (unsigned long)histogram->count, histogram->count == 1 ? "call" : "calls",
+            (double)histogram->total / 1e6,
+            (unsigned long)histogram_percentile(histogram, 0.50),
+            (unsigned long)histogram_percentile(histogram, 0.99),
+            (unsigned long)histogram_percentile(histogram, 0.999),
+            (unsigned long)histogram->max);
+  }
+}
+
+/**
+Appends the profile to the dump file if the dump interval has passed
+@param now: the current time in nanoseconds
+**/
+static void profile_dump(uint64_t now)
+{
+  if(profile_path[0] == '\0' || now - profile_last_dump < profile_interval)
+  {
+    return;
+  }
+  profile_last_dump = now;
+  FILE* out = fopen(profile_path, "a");
+  if(out == NULL)
+  {
+    return;
+  }
+  fprintf(out, "time %lu ns\n", (unsigned long)now);
+  profile_write(out);
+  fclose(out);
+}
+
+/**
+Adds the counts of a table stage to its totals, installed as the table
+observer while counters are on
+@param stage: the stage
+@param starting: true as the stage starts, false as it ends
+**/
+static void count_stage(ht_stage_t stage, bool starting)
+{
+  if(starting == true)
+  {
+    perf_read(stage_start);
+    return;
+  }
+  uint64_t now[PERF_COUNTERS];
+  perf_read(now);
+  for(unsigned i = 0; i < PERF_COUNTERS; i++)
+  {
+    stage_totals[stage][i]+=now[i] - stage_start[i];
+  }
+  stage_calls[stage]+=1;
+}
+
+/**
+Prints the average counts of one kind of command or table stage
+@param label: what was counted
+@param calls: the number of times it was counted
+@param totals: the counts summed over all the calls
+**/
+static void print_counter_line(const char* label, uint64_t calls, const uint64_t totals[PERF_COUNTERS])
+{
+  printf("\t%s: %lu %s", label, (unsigned long)calls, calls == 1 ? "call" : "calls");
+  for(unsigned i = 0; i < PERF_COUNTERS; i++)
+  {
+    if(perf_running(i) == true)
+    {
+      printf(", %.1f %s", (double)totals[i] / (double)calls, perf_counter_names[i]);
+    }
+  }
+  if(perf_running(0) == true && perf_running(1) == true && totals[0] > 0)
+  {
+    printf(", %.2f ipc", (double)totals[1] / (double)totals[0]);
+  }
+  printf("\n");
+}
+#endif
+
+/**
+Turns hardware counters on or off, clears them, or prints per call averages
+of each kind of command and of hashtable probes and resizes
+@param action: NULL to print, "on", "off" or "reset"
+@param file: true if command was called from file input, false otherwise
+**/
+void print_counters(char* action, bool file)
 {
   if(file == false)
   {
-    printf("Amici> + \"add\" \"%s\" \"%s\" \"%s\"\n", first_name, last_name, handle);
+    if(action == NULL)
+    {
+      printf("Amici> + \"counters\"\n");
+    }
+    else
+    {
+      printf("Amici> + \"counters\" \"%s\"\n", action);
+    }
+  }
+#ifdef AMICI_NO_PROFILE
+  fprintf(stdout, "error: profiling was compiled out\n");
+  fflush(stdout);
+#else
+  if(action == NULL)
+  {
+    printf("Counters: %s\n", counters_on == true ? "on" : "off");
+    if(counters_on == false)
+    {
+      return;
+    }
+    for(size_t i = 0; i < PROFILE_KINDS; i++)
+    {
+      if(counter_calls[i] > 0)
+      {
+        print_counter_line(profile_names[i], counter_calls[i], counter_totals[i]);
+      }
+    }
+    if(stage_calls[HT_PROBE] > 0)
+    {
+      print_counter_line("hash probe", stage_calls[HT_PROBE], stage_totals[HT_PROBE]);
+    }
+    if(stage_calls[HT_RESIZE] > 0)
+    {
+      print_counter_line("hash resize", stage_calls[HT_RESIZE], stage_totals[HT_RESIZE]);
+    }
+  }
+  else if(strcasecmp(action, "on") == 0)
+  {
+    if(counters_on == true)
+    {
+      printf("Counters are already on.\n");
+      return;
+    }
+    // the pool threads inherit counters only if they start after them, so
+    // the pool is stopped and restarts under the counters
+    parallel_stop();
+    if(perf_start() == 0)
+    {
+      fprintf(stdout, "error: hardware counters are unavailable\n");
+      fflush(stdout);
+    }
+    else
+    {
+      counters_on = true;
+      ht_observe(count_stage);
+      printf("Counters on:");
+      for(unsigned i = 0; i < PERF_COUNTERS; i++)
+      {
+        if(perf_running(i) == true)
+        {
+          printf(" %s", perf_counter_names[i]);
+        }
+      }
+      printf(perf_counts_threads() == true ? " (all threads)\n" : " (main thread only)\n");
+    }
+  }
+  else if(strcasecmp(action, "off") == 0)
+  {
+    ht_observe(NULL);
+    perf_stop();
+    counters_on = false;
+    printf("Counters off.\n");
+  }
+  else
+  {
+    memset(counter_calls, 0, sizeof(counter_calls));
+    memset(counter_totals, 0, sizeof(counter_totals));
+    memset(stage_calls, 0, sizeof(stage_calls));
+    memset(stage_totals, 0, sizeof(stage_totals));
+    printf("Counters reset.\n");
+  }
+#endif
+}
+
+/**
+Prints the latency of each kind of command, clears it, or sets up appending
+it to a file every so many seconds
+@param action: NULL to print, "reset", or "dump"
+@param path: the file to dump to, for "dump"
+@param seconds: the seconds between dumps, 0 to stop dumping, for "dump"
+@param file: true if command was called from file input, false otherwise
+**/
+void print_profile(char* action, char* path, char* seconds, bool file)
+{
+  if(file == false)
+  {
+    if(action == NULL)
+    {
+      printf("Amici> + \"profile\"\n");
+    }
+    else if(path == NULL)
+    {
+      printf("Amici> + \"profile\" \"%s\"\n", action);
+    }
+    else
+    {
+      printf("Amici> + \"profile\" \"%s\" \"%s\" \"%s\"\n", action, path, seconds);
+    }
+  }
+#ifdef AMICI_NO_PROFILE
+  (void)path;
+  (void)seconds;
+  fprintf(stdout, "error: profiling was compiled out\n");
+  fflush(stdout);
+#else
+  if(action == NULL)
+  {
+    profile_write(stdout);
+  }
+  else if(strcasecmp(action, "reset") == 0)
+  {
+    memset(profile_histograms, 0, sizeof(profile_histograms));
+    printf("Profile reset.\n");
+  }
+  else
+  {
+    char* end = NULL;
+    double interval = strtod(seconds, &end);
+    if(*end != '\0' || interval < 0 || strlen(path) >= sizeof(profile_path))
+    {
+      fprintf(stdout,"error: argument \"%s\" is invalid\n", *end != '\0' || interval < 0 ? seconds : path);
+      fflush(stdout);
+    }
+    else if(interval == 0)
+    {
+      profile_path[0] = '\0';
+      printf("Profile dumps stopped.\n");
+    }
+    else
+    {
+      strcpy(profile_path, path);
+      profile_interval = (uint64_t)(interval * 1e9);
+      profile_last_dump = profile_now();
+      printf("Profile dumped to %s every %s seconds.\n", path, seconds);
+    }
+  }
+#endif
+}
+
+/**
+Given a command from the stdin or file, it determines which function must be
+done to complete the command and gives errors if argument numbers are incorrect
+@param hashtable: Hashtable containing people
+@param tokens: the command in a 5 word char array
+@param file: true if command was called from file input, false otherwise
+**/
+static void dispatch_command(HashADT* hashtable, char* tokens[5], bool file)
+{
+  if(replica != NULL && strcasecmp(tokens[0], "print") != 0 && strcasecmp(tokens[0], "size") != 0 &&
+     strcasecmp(tokens[0], "stats") != 0 && strcasecmp(tokens[0], "quit") != 0)
+  {
+    fprintf(stdout, "error: a read replica only serves print, size and stats\n");
+    fflush(stdout);
+    return;
+  }
+  if(strcasecmp(tokens[0], "add") == 0)
+  {
+    if(tokens[4] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: add first-name last-name handle\n");
+      fflush(stdout);
+    }
+    else if(tokens[3] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: add first-name last-name handle\n");
+      fflush(stdout);
+    }
+    else
+    {
+      add_person(*hashtable, tokens[1], tokens[2], tokens[3], file);
+    }
+  }
+  else if(strcasecmp(tokens[0], "friend") == 0)
+  {
+    if(tokens[3] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: friend handle1 handle2\n");
+      fflush(stdout);
+    }
+    else if(tokens[2] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: friend handle1 handle2\n");
+      fflush(stdout);
+    }
+    else
+    {
+      add_friend(*hashtable, tokens[1], tokens[2], file);
+    }
+  }
+  else if(strcasecmp(tokens[0], "unfriend") == 0)
+  {
+    if(tokens[3] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: unfriend handle1 handle2\n");
+      fflush(stdout);
+    }
+    else if(tokens[2] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: unfriend handle1 handle2\n");
+      fflush(stdout);
+    }
+    else
+    {
+      unfriend_person(*hashtable, tokens[1], tokens[2], file);
+    }
+  }
+  else if(strcasecmp(tokens[0], "remove") == 0)
+  {
+    if(tokens[2] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: remove handle\n");
+      fflush(stdout);
+    }
+    else if(tokens[1] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: remove handle\n");
+      fflush(stdout);
+    }
+    else
+    {
+      remove_person(*hashtable, tokens[1], file);
+    }
+  }
+  else if(strcasecmp(tokens[0], "print") == 0)
+  {
+    if(tokens[2] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: print handle\n");
+      fflush(stdout);
+    }
+    else if(tokens[1] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: print handle\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_handle(*hashtable, tokens[1], file);
+    }
+  }
+  else if(strcasecmp(tokens[0], "size") == 0)
+  {
+    if(tokens[2] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: size handle\n");
+      fflush(stdout);
+    }
+    else if(tokens[1] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: size handle\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_size(*hashtable, tokens[1], file);
+    }
   }
-  if(ht_has(hashtable, handle) == true)
+  else if(strcasecmp(tokens[0], "stats") == 0)
   {
-    fprintf(stdout, "error: handle \"%s\" is already in use\n", handle);
-    fflush(stdout);
-    return;
+    if(tokens[1] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: stats\n");
+      fflush(stdout);
+    }
+    print_stats(*hashtable, file);
   }
-  else
+  else if(strcasecmp(tokens[0], "mutual") == 0)
   {
-    size_t first_len = strlen(first_name);
-    size_t last_len = strlen(last_name);
-    char* full_name = (char*)malloc(first_len + 1 + last_len + 1);
-    snprintf(full_name, first_len + 1 + last_len + 1, "%s %s", first_name, last_name);
-    person_t* person = (person_t*)malloc(sizeof(struct person_s));
-    person->name = strdup(full_name);
-    person->handle = strdup(handle);
-    person->max_friends = 16;
-    person->friends = calloc(person->max_friends, sizeof(struct person_s));
-    person->friend_count = 0;
-    bool first_name_alphabet = true;
-    bool last_name_alphabet = true;
-    bool handle_alphabet_number = true;
-    for(size_t i = 0; i < strlen(first_name); i++)
+    if(tokens[3] != NULL)
     {
-      if(isalpha(first_name[i]) == 0)
-      {
-        first_name_alphabet = false;
-        break;
-      }
+      fprintf(stdout, "Amici> error: usage: mutual handle1 handle2\n");
+      fflush(stdout);
     }
-    for(size_t i = 0; i < strlen(last_name); i++) 
+    else if(tokens[2] == NULL)
     {
-      if(isalpha(last_name[i]) == 0)
-      {
-        last_name_alphabet = false;
-        break;
-      }
+      fprintf(stdout, "Amici> error: usage: mutual handle1 handle2\n");
+      fflush(stdout);
     }
-    for(size_t i = 0; i < strlen(handle); i++) 
+    else
     {
-      if(!isalpha(handle[i]) && !isdigit(handle[i]))
-      {
-        handle_alphabet_number = false;
-        break;
-      }
+      print_mutual(*hashtable, tokens[1], tokens[2], file);
     }
-    if(first_name_alphabet == false)
+  }
+  else if(strcasecmp(tokens[0], "suggest") == 0)
+  {
+    if(tokens[3] != NULL)
     {
-      fprintf(stdout,"error: argument \"%s\" is invalid\n", first_name);
-      free(person->name);
-      free(person->handle);
-      free(person->friends);
-      free(person);
-      free(full_name);
+      fprintf(stdout, "Amici> error: usage: suggest handle k\n");
       fflush(stdout);
-      return;
     }
-    else if(last_name_alphabet == false)
+    else if(tokens[2] == NULL)
     {
-      fprintf(stdout,"error: argument \"%s\" is invalid\n", last_name); 
-      free(person->name);
-      free(person->handle);
-      free(person->friends);
-      free(person);
-      free(full_name);
+      fprintf(stdout, "Amici> error: usage: suggest handle k\n");
       fflush(stdout);
-      return;
     }
-    else if(handle_alphabet_number == false)
+    else
     {
-      fprintf(stdout,"error: argument \"%s\" is invalid\n", handle); 
-      free(person->name);
-      free(person->handle);
-      free(person->friends);
-      free(person);
-      free(full_name);
+      print_suggestions(*hashtable, tokens[1], tokens[2], file);
+    }
+  }
+  else if(strcasecmp(tokens[0], "path") == 0)
+  {
+    if(tokens[3] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: path handle1 handle2\n");
       fflush(stdout);
-      return;
     }
-    ht_put(hashtable, person->handle, person);
-    size_of_hashtable+=1;
-    free(full_name);
+    else if(tokens[2] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: path handle1 handle2\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_path(*hashtable, tokens[1], tokens[2], file);
+    }
   }
-}
-
-/**
-Creates a friendship between two people and added to each other friends list
-@param hashtable: Hashtable containing people
-@param handle1: the handle of one of the people
-@param handle2: the handle of the other person
-@param file: true if command was called from file input, false otherwise
-**/
-void add_friend(HashADT hashtable, char* handle1, char* handle2, bool file)
-{
-  if(file == false)
+  else if(strcasecmp(tokens[0], "components") == 0)
   {
-    printf("Amici> + \"friend\" \"%s\" \"%s\"\n", handle1, handle2);
+    if(tokens[1] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: components\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_components(file);
+    }
   }
-  if(ht_has(hashtable, handle1) == false)
+  else if(strcasecmp(tokens[0], "connected") == 0)
   {
-    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle1);
-    fflush(stdout);
+    if(tokens[3] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: connected handle1 handle2\n");
+      fflush(stdout);
+    }
+    else if(tokens[2] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: connected handle1 handle2\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_connected(*hashtable, tokens[1], tokens[2], file);
+    }
   }
-  else if(ht_has(hashtable, handle2) == false)
+  else if(strcasecmp(tokens[0], "triangles") == 0)
   {
-    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle2);
-    fflush(stdout);
+    if(tokens[1] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: triangles\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_triangles(file);
+    }
   }
-  else if(strcmp(handle1, handle2) == 0)
+  else if(strcasecmp(tokens[0], "clustering") == 0)
   {
-    fprintf(stdout, "error: \"%s\" and \"%s\" are the same person\n", handle1, handle2);
-    fflush(stdout);
+    if(tokens[2] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: clustering [handle]\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_clustering(*hashtable, tokens[1], file);
+    }
   }
-  else
+  else if(strcasecmp(tokens[0], "rank") == 0)
   {
-    person_t* person1 = (person_t*)ht_get(hashtable, handle1);
-    person_t* person2 = (person_t*)ht_get(hashtable, handle2);
-    bool friend_already = false;
-    for(size_t i = 0; i < person1->friend_count; i++)
+    if(tokens[3] != NULL)
     {
-      char* handle_friend = (person1->friends[i])->handle;
-      if(strcmp(handle_friend, handle2) == 0)
-      {
-        friend_already = true;
-        break;
-      }
+      fprintf(stdout, "Amici> error: usage: rank k [tolerance]\n");
+      fflush(stdout);
     }
-    if(friend_already == true)
+    else if(tokens[1] == NULL)
     {
-      fprintf(stdout,"%s and %s are already friends.\n", handle1, handle2);
+      fprintf(stdout, "Amici> error: usage: rank k [tolerance]\n");
       fflush(stdout);
     }
     else
     {
-      if(person1->friend_count == person1->max_friends)
-      {
-        person1->max_friends*=2;
-        person1->friends = realloc(person1->friends, sizeof(struct person_s) * person1->max_friends);
-        for(size_t i = person1->max_friends/2; i < person1->max_friends; i++)
-        {
-          person1->friends[i] = NULL;
-        }
-      }
-      if(person2->friend_count == person2->max_friends)
-      {
-        person2->max_friends*=2;
-        person2->friends = realloc(person2->friends, sizeof(struct person_s) * person2->max_friends);
-        for(size_t i = person2->max_friends/2; i < person2->max_friends; i++)
-        {
-          person2->friends[i] = NULL;
-        }
-      }
-      for(size_t i = 0; i < person1->max_friends; i++)
-      {
-        if(person1->friends[i] == NULL)
-        {
-          person1->friends[i] = person2;
-          person1->friend_count+=1;
-          break;
-        }
-      }
-      for(size_t i = 0; i < person2->max_friends; i++)
-      {
-        if(person2->friends[i] == NULL)
-        {
-          person2->friends[i] = person1;
-          person2->friend_count+=1;
-          break;
-        }
-      }
-      printf("%s and %s are now friends.\n", handle1, handle2);
+      print_rank(tokens[1], tokens[2], file);
     }
   }
-}
-
-/**
-Unfriends a person by getting rid of them in there friends list
-@param hashtable: Hashtable containing people
-@param handle1: the handle of one of the people
-@param handle2: the handle of the other person
-@param file: true if command was called from file input, false otherwise
-**/
-void unfriend_person(HashADT hashtable, char* handle1, char* handle2, bool file)
-{
-  if(file == false)
-  {
-    printf("Amici> + \"unfriend\" \"%s\" \"%s\"\n", handle1, handle2);
-  }
-  if(ht_has(hashtable, handle1) == false)
+  else if(strcasecmp(tokens[0], "top") == 0)
   {
-    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle1);
-    fflush(stdout);
-  }
-  else if(ht_has(hashtable, handle2) == false)
-  {
-    fprintf(stdout, "error: handle \"%s\" is unknown\n", handle2);
-    fflush(stdout);
+    if(tokens[2] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: top k\n");
+      fflush(stdout);
+    }
+    else if(tokens[1] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: top k\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_top(tokens[1], file);
+    }
   }
-  else if(strcmp(handle1, handle2) == 0)
+  else if(strcasecmp(tokens[0], "find") == 0)
   {
-    fprintf(stdout, "error: \"%s\" and \"%s\" are the same person\n", handle1, handle2);
-    fflush(stdout);
+    if(tokens[3] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: find prefix [n]\n");
+      fflush(stdout);
+    }
+    else if(tokens[1] == NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: find prefix [n]\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_find(tokens[1], tokens[2], file);
+    }
   }
-  else
+  else if(strcasecmp(tokens[0], "snapshot") == 0)
   {
-    person_t* person1 = (person_t*)ht_get(hashtable, handle1);
-    person_t* person2 = (person_t*)ht_get(hashtable, handle2);
-    bool friends = false;
-    for(size_t i = 0; i < person1->max_friends; i++)
+    if(tokens[1] == NULL)
     {
-      if(person1->friends[i] == 0)
-      {
-        //do nothing because NULL/0
-      }
-      else if(strcmp((person1->friends[i])->handle, handle2) == 0)
-      {
-        person1->friends[i] = 0;
-        person1->friend_count-=1;
-        friends = true;
-        break;
-      }
+      take_snapshot(*hashtable, file);
     }
-    for(size_t i = 0; i < person2->max_friends; i++)
+    else if(strcasecmp(tokens[1], "stats") == 0 && tokens[2] == NULL)
     {
-      if(person2->friends[i] == 0)
-      {
-        //do nothing because NULL/0
-      }
-      else if(strcmp((person2->friends[i])->handle, handle1) == 0)
-      {
-        person2->friends[i] = 0;
-        person2->friend_count-=1;
-        break;
-      }
+      snapshot_stats(file);
     }
-    if(friends == true)
+    else if(strcasecmp(tokens[1], "print") == 0 && tokens[2] != NULL && tokens[3] == NULL)
     {
-      printf("%s and %s are no longer friends.\n", handle1, handle2);
+      snapshot_print(*hashtable, tokens[2], file);
+    }
+    else if(strcasecmp(tokens[1], "drop") == 0 && tokens[2] == NULL)
+    {
+      if(file == false)
+      {
+        printf("Amici> + \"snapshot\" \"drop\"\n");
+      }
+      drop_snapshot();
     }
     else
     {
-      fprintf(stdout,"%s and %s are not friends.\n", handle1, handle2);
+      fprintf(stdout, "Amici> error: usage: snapshot [stats | print handle | drop]\n");
       fflush(stdout);
     }
   }
-}
-
-/**
-Prints the persons handle along with the person friends
-@param hashtable: Hashtable containing people
-@param handle: the handle of the person
-@param file: true if command was called from file input, false otherwise
-**/
-void print_handle(HashADT hashtable, char* handle, bool file)
-{
-  if(file == false)
+  else if(strcasecmp(tokens[0], "init") == 0)
   {
-    printf("Amici> + \"print\" \"%s\"\n", handle);
+    if(tokens[1] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: init\n");
+      fflush(stdout);
+    }
+    *hashtable = init(*hashtable, file);
   }
-  if(ht_has(hashtable, handle) == false)
+  else if(strcasecmp(tokens[0], "profile") == 0)
   {
-    fprintf(stdout,"error: handle \"%s\" is unknown\n", handle);
-    fflush(stdout);
+    if(tokens[1] == NULL)
+    {
+      print_profile(NULL, NULL, NULL, file);
+    }
+    else if(strcasecmp(tokens[1], "reset") == 0 && tokens[2] == NULL)
+    {
+      print_profile(tokens[1], NULL, NULL, file);
+    }
+    else if(strcasecmp(tokens[1], "dump") == 0 && tokens[2] != NULL && tokens[3] != NULL && tokens[4] == NULL)
+    {
+      print_profile(tokens[1], tokens[2], tokens[3], file);
+    }
+    else
+    {
+      fprintf(stdout, "Amici> error: usage: profile [reset | dump file seconds]\n");
+      fflush(stdout);
+    }
   }
-  else
+  else if(strcasecmp(tokens[0], "publish") == 0)
   {
-    person_t* person = (person_t*)ht_get(hashtable, handle);
-    if(person->friend_count > 1)
+    if(tokens[2] != NULL)
     {
-      printf("%s (%s) has %ld friends\n", handle, person->name, person->friend_count);
-      for(size_t i = 0; i < person->max_friends; i++)
-      {
-        if(person->friends[i] != 0)
-        {
-          printf("\t%s (%s)\n", (person->friends[i])->handle, (person->friends[i])->name);
-        }
-      }
+      fprintf(stdout, "Amici> error: usage: publish name\n");
+      fflush(stdout);
     }
-    else if(person->friend_count == 1)
+    else if(tokens[1] == NULL)
     {
-      printf("%s (%s) has 1 friend\n", handle, person->name);
-      for(size_t i = 0; i < person->max_friends; i++)
-      {
-        if(person->friends[i] != 0)
-        {
-          printf("\t%s (%s)\n", (person->friends[i])->handle, (person->friends[i])->name);
-          break;
-        }
-      }
+      fprintf(stdout, "Amici> error: usage: publish name\n");
+      fflush(stdout);
     }
     else
     {
-      printf("%s (%s) has no friends\n", handle, person->name);
+      publish_image(tokens[1], file);
     }
   }
-}
-/**
-Prints the persons handle along with the number of friends the person has
-@param hashtable: Hashtable containing people
-@param handle: the handle of the person
-@param file: true if command was called from file input, false otherwise
-**/
-
-void print_size(HashADT hashtable, char* handle, bool file)
-{
-  if(file == false)
-  {
-    printf("Amici> + \"size\" \"%s\"\n", handle);
-  }
-  if(ht_has(hashtable, handle) == false)
-  {
-    fprintf(stdout,"error: handle \"%s\" is unknown\n", handle);
-    fflush(stdout);
-  }
-  else
+  else if(strcasecmp(tokens[0], "export") == 0)
   {
-    person_t* person = (person_t*)ht_get(hashtable, handle);
-    if(person->friend_count > 1)
+    if(tokens[3] != NULL)
     {
-      printf("%s (%s) has %ld friends\n", handle, person->name, person->friend_count);
+      fprintf(stdout, "Amici> error: usage: export file [edgelist | adjacency]\n");
+      fflush(stdout);
     }
-    else if(person->friend_count == 1)
+    else if(tokens[1] == NULL)
     {
-      printf("%s (%s) has 1 friend\n", handle, person->name);
+      fprintf(stdout, "Amici> error: usage: export file [edgelist | adjacency]\n");
+      fflush(stdout);
     }
     else
     {
-      printf("%s (%s) has no friends\n", handle, person->name);
+      export_graph(tokens[1], tokens[2], file);
     }
   }
-}
-/**
-Loops through the hashtable, and prints the number of people in the hashtable
-as well as the number of friendships
-@param hashtable: Hashtable containing people
-@param file: true if command was called from file input, false otherwise
-**/
-void print_stats(HashADT hashtable, bool file)
-{
-  if(file == false)
+  else if(strcasecmp(tokens[0], "cache") == 0)
   {
-    printf("Amici> + \"stats\"\n");
+    if(tokens[2] != NULL)
+    {
+      fprintf(stdout, "Amici> error: usage: cache [bytes]\n");
+      fflush(stdout);
+    }
+    else
+    {
+      print_cache(tokens[1], file);
+    }
   }
-  char** keys = (char**)ht_keys(hashtable);
-  if(keys != NULL)
+  else if(strcasecmp(tokens[0], "memory") == 0)
   {
-    size_t total_friends = 0;
-    for(size_t i = 0; i < size_of_hashtable; i++)
+    if(tokens[1] != NULL)
     {
-      person_t* person = (person_t*)ht_get(hashtable, keys[i]);
-      total_friends+=person->friend_count;
+      fprintf(stdout, "Amici> error: usage: memory\n");
+      fflush(stdout);
     }
-    if(size_of_hashtable == 1)
+    else
     {
-      printf("Statistics:  1 person, no friendships\n");
+      print_memory(file);
     }
-    else if(size_of_hashtable > 1 && total_friends == 0)
+  }
+  else if(strcasecmp(tokens[0], "counters") == 0)
+  {
+    if(tokens[2] != NULL)
     {
-      printf("Statistics:  %ld people, no friendships\n", size_of_hashtable);
+      fprintf(stdout, "Amici> error: usage: counters [on | off | reset]\n");
+      fflush(stdout);
     }
-    else if(size_of_hashtable > 1 && total_friends/2 == 1)
+    else if(tokens[1] == NULL || strcasecmp(tokens[1], "on") == 0 ||
+            strcasecmp(tokens[1], "off") == 0 || strcasecmp(tokens[1], "reset") == 0)
     {
-      printf("Statistics:  %ld people, 1 friendship\n", size_of_hashtable);
+      print_counters(tokens[1], file);
     }
     else
     {
-      printf("Statistics:  %ld people, %ld friendships\n", size_of_hashtable, total_friends/2);
+      fprintf(stdout, "Amici> error: usage: counters [on | off | reset]\n");
+      fflush(stdout);
     }
-    free(keys);
+  }
+  else if(strcasecmp(tokens[0], "quit") == 0)
+  {
+    quit(*hashtable);
   }
   else
   {
-    printf("Statistics:  no people, no friendships\n");
+    printf("Amici> ");
   }
 }
 
 /**
-Gets rid of all dynamic allocated memory and the hashtable, and creates a new hashtable
+Runs a command, timing it into the profile unless AMICI_NO_PROFILE is defined
 @param hashtable: Hashtable containing people
+@param tokens: the command in a 5 word char array
 @param file: true if command was called from file input, false otherwise
 **/
-HashADT init(HashADT hashtable, bool file)
+void process_command(HashADT* hashtable, char* tokens[5], bool file)
 {
-  if(file == false)
+#ifdef AMICI_NO_PROFILE
+  dispatch_command(hashtable, tokens, file);
+#else
+  size_t kind = profile_kind(tokens[0]);
+  bool counting = counters_on;
+  uint64_t before[PERF_COUNTERS];
+  if(counting == true)
   {
-    printf("Amici> + \"init\"\n");
-  }
-  char** keys = (char**)ht_keys(hashtable);
-  for(size_t i = 0; i < size_of_hashtable; i++)
-  {
-    person_t* person = (person_t*)ht_get(hashtable, keys[i]);
-    free(person->friends);
-    free(person->name);
-    free(person);
+    perf_read(before);
   }
-  for(size_t i = 0; i < size_of_hashtable; i++)
+  uint64_t start = profile_now();
+  dispatch_command(hashtable, tokens, file);
+  uint64_t end = profile_now();
+  // a counters command may have stopped the counters while it ran
+  if(counting == true && counters_on == true)
   {
-    free(keys[i]);
+    uint64_t after[PERF_COUNTERS];
+    perf_read(after);
+    for(unsigned i = 0; i < PERF_COUNTERS; i++)
+    {
+      counter_totals[kind][i]+=after[i] - before[i];
+    }
+    counter_calls[kind]+=1;
   }
-  free(keys);
-  ht_destroy(hashtable);
-  hashtable = ht_create(str_hash, str_equals, NULL, NULL);
-  size_of_hashtable = 0;
-  printf("System re-initialized\n");
-  return(hashtable);
+  histogram_record(&profile_histograms[kind], end - start);
+  profile_dump(end);
+#endif
 }
 
+//the most commands batch mode reads from the data file before running them
+#define BATCH_WINDOW 4096
+
+/// A friend or unfriend command of a batch, with its people looked up
+typedef struct batch_op_s {
+    char **tokens;     //the command
+    uint32_t id1;     //the id of the person named first
+    uint32_t id2;     //the id of the person named second
+    bool befriend;     //true for friend, false for unfriend
+    bool changed;     //the friendship was made or ended when applied
+    size_t degree1;     //friend count of person1 right after the command
+    size_t degree2;     //friend count of person2 right after the command
+    uint32_t round;     //the commands of a round all touch different people
+} batch_op_t;
+
 /**
-Gets rid of all dynamic allocated memory and the hashtable and closes the program
+Looks up the people of a command if it can join a batch. Only friend and
+unfriend commands of two different, known people can, the rest run alone
 @param hashtable: Hashtable containing people
+@param tokens: the command in a 5 word char array
+@param op: filled in when the command can join a batch
+@return true if the command can join a batch
 **/
-int quit(HashADT hashtable)
+static bool resolve_batch_op(HashADT hashtable, char* tokens[5], batch_op_t* op)
 {
-  printf("Amici> + \"quit\"\n");
-  if(size_of_hashtable == 0)
+  if(replica != NULL || tokens[0] == NULL || tokens[2] == NULL || tokens[3] != NULL)
   {
-    ht_destroy(hashtable);
-    return(EXIT_SUCCESS);
+    return(false);
+  }
+  if(strcasecmp(tokens[0], "friend") == 0)
+  {
+    op->befriend = true;
+  }
+  else if(strcasecmp(tokens[0], "unfriend") == 0)
+  {
+    op->befriend = false;
   }
   else
   {
-    char** keys = (char**)ht_keys(hashtable);
-    for(size_t i = 0; i < size_of_hashtable; i++)
-    {
-      person_t* person = (person_t*)ht_get(hashtable, keys[i]);
-      free(person->friends);
-      free(person->name);
-      free(person);
-    }
-    for(size_t i = 0; i < size_of_hashtable; i++)
-    {
-      free(keys[i]);
-    }
-    free(keys);
-    ht_destroy(hashtable);
-    size_of_hashtable = 0;
-    return(EXIT_SUCCESS);
+    return(false);
+  }
+  if(strcmp(tokens[1], tokens[2]) == 0 || ht_has(hashtable, tokens[1]) == false ||
+     ht_has(hashtable, tokens[2]) == false)
+  {
+    return(false);
   }
+  op->tokens = tokens;
+  op->id1 = handle_id(hashtable, tokens[1]);
+  op->id2 = handle_id(hashtable, tokens[2]);
+  return(true);
 }
 
 /**
-Given a command from the stdin or file, it determines which function must be
-done to complete the command and gives errors if argument numbers are incorrect
-@param hashtable: Hashtable containing people
-@param tokens: the command in a 5 word char array
-@param file: true if command was called from file input, false otherwise
+Applies the friends list changes of some commands of one round
+@param first: index of the first command
+@param last: one past the index of the last command
+@param arg: the commands of the round
+@param worker: unused
 **/
-void process_command(HashADT* hashtable, char* tokens[5], bool file)
+static void apply_batch(size_t first, size_t last, void *arg, unsigned worker)
 {
-  if(strcasecmp(tokens[0], "add") == 0)
+  (void)worker;
+  batch_op_t** round = (batch_op_t**)arg;
+  for(size_t i = first; i < last; i++)
   {
-    if(tokens[4] != NULL)
-    {
-      fprintf(stdout, "Amici> error: usage: add first-name last-name handle\n");
-      fflush(stdout);
-    }
-    else if(tokens[3] == NULL)
+    batch_op_t* op = round[i];
+    if(op->befriend == true)
     {
-      fprintf(stdout, "Amici> error: usage: add first-name last-name handle\n");
-      fflush(stdout);
+      op->changed = link_friends(op->id1, op->id2);
     }
     else
     {
-      add_person(*hashtable, tokens[1], tokens[2], tokens[3], file);
+      op->changed = unlink_friends(op->id1, op->id2);
     }
+    op->degree1 = friend_counts_by_id[op->id1];
+    op->degree2 = friend_counts_by_id[op->id2];
   }
-  else if(strcasecmp(tokens[0], "friend") == 0)
+}
+
+/**
+Runs friend and unfriend commands as a batch. Each command is put in the
+round after the last one that touched either of its people, the rounds
+change the friends lists in turn with the commands of a round in parallel,
+then the degree buckets, groups and counts are updated and the results
+printed in command order, so the outcome is that of running them one by one
+@param ops: the commands, in the order they were given
+@param count: the number of commands
+@param file: true if the commands were called from file input, false otherwise
+**/
+static void run_batch_ops(batch_op_t* ops, size_t count, bool file)
+{
+  if(count == 0)
   {
-    if(tokens[3] != NULL)
-    {
-      fprintf(stdout, "Amici> error: usage: friend handle1 handle2\n");
-      fflush(stdout);
-    }
-    else if(tokens[2] == NULL)
-    {
-      fprintf(stdout, "Amici> error: usage: friend handle1 handle2\n");
-      fflush(stdout);
-    }
-    else
+    return;
+  }
+  if(batch_capacity < people_count)
+  {
+    size_t old_capacity = batch_capacity;
+    batch_capacity = people_capacity;
+    batch_rounds = mem_realloc(MEM_INDEXES, batch_rounds, sizeof(uint32_t) * batch_capacity);
+    assert(batch_rounds != NULL);
+    memset(batch_rounds + old_capacity, 0, sizeof(uint32_t) * (batch_capacity - old_capacity));
+  }
+#ifndef AMICI_NO_PROFILE
+  uint64_t start = profile_now();
+#endif
+  uint32_t rounds = 0;
+  for(size_t i = 0; i < count; i++)
+  {
+    uint32_t round1 = batch_rounds[ops[i].id1];
+    uint32_t round2 = batch_rounds[ops[i].id2];
+    ops[i].round = (round1 > round2 ? round1 : round2) + 1;
+    batch_rounds[ops[i].id1] = ops[i].round;
+    batch_rounds[ops[i].id2] = ops[i].round;
+    if(ops[i].round > rounds)
     {
-      add_friend(*hashtable, tokens[1], tokens[2], file);
+      rounds = ops[i].round;
     }
   }
-  else if(strcasecmp(tokens[0], "unfriend") == 0)
+  // counting sort by round, starts[r] is where round r begins in order
+  size_t* starts = calloc(rounds + 2, sizeof(size_t));
+  batch_op_t** order = malloc(sizeof(batch_op_t*) * count);
+  assert(starts != NULL && order != NULL);
+  for(size_t i = 0; i < count; i++)
   {
-    if(tokens[3] != NULL)
+    starts[ops[i].round + 1]+=1;
+  }
+  for(uint32_t round = 1; round <= rounds; round++)
+  {
+    starts[round + 1]+=starts[round];
+  }
+  for(size_t i = 0; i < count; i++)
+  {
+    order[starts[ops[i].round]] = &ops[i];
+    starts[ops[i].round]+=1;
+  }
+  // each start moved to the end of its round, the start of the next
+  size_t begin = 0;
+  for(uint32_t round = 1; round <= rounds; round++)
+  {
+    // friends arrays are moved here, before the round runs in parallel
+    for(size_t i = begin; i < starts[round]; i++)
     {
-      fprintf(stdout, "Amici> error: usage: unfriend handle1 handle2\n");
-      fflush(stdout);
+      prepare_friends(order[i]->id1, order[i]->befriend);
+      prepare_friends(order[i]->id2, order[i]->befriend);
     }
-    else if(tokens[2] == NULL)
+    // chunks are sized from the round, so small rounds still spread out
+    parallel_for(starts[round] - begin, parallel_chunk(starts[round] - begin), apply_batch, order + begin);
+    begin = starts[round];
+  }
+  free(starts);
+  free(order);
+  for(size_t i = 0; i < count; i++)
+  {
+    batch_op_t* op = &ops[i];
+    char* handle1 = op->tokens[1];
+    char* handle2 = op->tokens[2];
+    batch_rounds[op->id1] = 0;
+    batch_rounds[op->id2] = 0;
+    if(file == false)
     {
-      fprintf(stdout, "Amici> error: usage: unfriend handle1 handle2\n");
-      fflush(stdout);
+      printf("Amici> + \"%s\" \"%s\" \"%s\"\n", op->befriend == true ? "friend" : "unfriend", handle1, handle2);
     }
-    else
+    if(op->befriend == true && op->changed == true)
     {
-      unfriend_person(*hashtable, tokens[1], tokens[2], file);
+      note_friendship(op->id1, op->degree1, op->id2, op->degree2);
+      printf("%s and %s are now friends.\n", handle1, handle2);
     }
-  }
-  else if(strcasecmp(tokens[0], "print") == 0)
-  {
-    if(tokens[2] != NULL)
+    else if(op->befriend == true)
     {
-      fprintf(stdout, "Amici> error: usage: print handle\n");
+      fprintf(stdout,"%s and %s are already friends.\n", handle1, handle2);
       fflush(stdout);
     }
-    else if(tokens[1] == NULL)
+    else if(op->changed == true)
     {
-      fprintf(stdout, "Amici> error: usage: print handle\n");
-      fflush(stdout);
+      note_unfriending(op->id1, op->degree1, op->id2, op->degree2);
+      printf("%s and %s are no longer friends.\n", handle1, handle2);
     }
     else
     {
-      print_handle(*hashtable, tokens[1], file);
+      fprintf(stdout,"%s and %s are not friends.\n", handle1, handle2);
+      fflush(stdout);
     }
   }
-  else if(strcasecmp(tokens[0], "size") == 0)
+#ifndef AMICI_NO_PROFILE
+  // the commands finish together, each is charged an equal share
+  uint64_t end = profile_now();
+  for(size_t i = 0; i < count; i++)
   {
-    if(tokens[2] != NULL)
-    {
-      fprintf(stdout, "Amici> error: usage: size handle\n");
-      fflush(stdout);
-    }
-    else if(tokens[1] == NULL)
+    histogram_record(&profile_histograms[profile_kind(ops[i].tokens[0])], (end - start) / count);
+  }
+  profile_dump(end);
+#endif
+}
+
+/**
+Runs a window of commands. Friend and unfriend commands in a row are
+applied together by run_batch_ops, any other command waits for those before
+it and runs alone through process_command, so the output is the same as
+running every command through process_command in order
+@param hashtable: Hashtable containing people
+@param commands: the commands, each in a 5 word char array
+@param count: the number of commands
+@param file: true if the commands were called from file input, false otherwise
+**/
+void process_batch(HashADT* hashtable, char* commands[][5], size_t count, bool file)
+{
+  batch_op_t* ops = malloc(sizeof(batch_op_t) * (count + 1));
+  assert(ops != NULL);
+  size_t pending = 0;
+  for(size_t i = 0; i < count; i++)
+  {
+    if(resolve_batch_op(*hashtable, commands[i], &ops[pending]) == true)
     {
-      fprintf(stdout, "Amici> error: usage: size handle\n");
-      fflush(stdout);
+      pending+=1;
     }
     else
     {
-      print_size(*hashtable, tokens[1], file);
+      run_batch_ops(ops, pending, file);
+      pending = 0;
+      process_command(hashtable, commands[i], file);
     }
   }
-  else if(strcasecmp(tokens[0], "stats") == 0)
+  run_batch_ops(ops, pending, file);
+  free(ops);
+}
+
+// the benchmark harness includes this file and drives process_command itself
+#ifndef AMICI_NO_MAIN
+/**
+Runs the commands of a data file through process_batch a window at a time
+@param hashtable: Hashtable containing people
+@param file: the data file
+**/
+static void run_batched_file(HashADT* hashtable, FILE* file)
+{
+  char (*lines)[1024] = malloc(sizeof(*lines) * BATCH_WINDOW);
+  char* (*commands)[5] = malloc(sizeof(*commands) * BATCH_WINDOW);
+  assert(lines != NULL && commands != NULL);
+  size_t count = 0;
+  bool more = true;
+  while(more == true)
   {
-    if(tokens[1] != NULL)
+    more = fgets(lines[count], sizeof(lines[count]), file) != NULL;
+    if(more == true)
     {
-      fprintf(stdout, "Amici> error: usage: stats\n");
-      fflush(stdout);
+      char *token = strtok(lines[count], " \t\n");
+      int index_counter = 0;
+      for(int i = 0; i < 5; i++)
+      {
+        commands[count][i] = NULL;
+      }
+      while(token != NULL)
+      {
+        if(index_counter < 5)
+        {
+          commands[count][index_counter] = token;
+        }
+        index_counter+=1;
+        token = strtok(NULL, " \t\n");
+      }
+      count+=1;
     }
-    print_stats(*hashtable, file);
-  }
-  else if(strcasecmp(tokens[0], "init") == 0)
-  {
-    if(tokens[1] != NULL)
+    if(count == BATCH_WINDOW || (more == false && count > 0))
     {
-      fprintf(stdout, "Amici> error: usage: init\n");
-      fflush(stdout);
+      process_batch(hashtable, commands, count, true);
+      count = 0;
     }
-    *hashtable = init(*hashtable, file);
-  }
-  else if(strcasecmp(tokens[0], "quit") == 0)
-  {
-    quit(*hashtable);
-  }
-  else
-  {
-    printf("Amici> ");
   }
+  free(lines);
+  free(commands);
 }
 
 /**
@@ -625,10 +4892,66 @@ process_command function
 **/
 int main(int argc, char * argv[])
 {
-  (void)argv;
+  const char* usage = "usage: amici [ -c ] [ -b ] [ -H thp | hugetlb ] [ -I ] [ -r image ] [ datafile ]\n";
+  bool huge_pages = false;
+  huge_pages_t pages = HUGE_THP;
+  // pages go on the node of the thread that first touches them unless -I
+  // spreads them over every node
+  bool interleave = false;
+  const char* image_name = NULL;
+  int option;
+  while((option = getopt(argc, argv, "cbH:Ir:")) != -1)
+  {
+    switch(option)
+    {
+      case 'c':
+        compressed_adjacency = true;
+        break;
+      case 'b':
+        batch_mode = true;
+        break;
+      case 'H':
+        if(strcmp(optarg, "thp") != 0 && strcmp(optarg, "hugetlb") != 0)
+        {
+          fprintf(stderr, "%s", usage);
+          return(EXIT_FAILURE);
+        }
+        huge_pages = true;
+        pages = strcmp(optarg, "thp") == 0 ? HUGE_THP : HUGE_HUGETLB;
+        break;
+      case 'I':
+        interleave = true;
+        break;
+      case 'r':
+        image_name = optarg;
+        break;
+      default:
+        fprintf(stderr, "%s", usage);
+        return(EXIT_FAILURE);
+    }
+  }
+  // what is left is the optional data file, moved to argv[1]
+  argc-=optind - 1;
+  argv+=optind - 1;
   if(argc > 2)
   {
-    fprintf(stderr, "usage: amici [ datafile ]\n");
+    fprintf(stderr, "%s", usage);
+    return(EXIT_FAILURE);
+  }
+  if(huge_pages == true || interleave == true)
+  {
+    // the table arrays and friend arrays are what random lookups land in
+    if(mem_use_huge_pages(MEM_TABLE, pages, interleave) == false ||
+       mem_use_huge_pages(MEM_FRIENDS, pages, interleave) == false)
+    {
+      fprintf(stderr, "error: huge pages cannot be set up\n");
+      return(EXIT_FAILURE);
+    }
+  }
+  if(image_name != NULL &&
+     (image_name_valid(image_name) == false || (replica = image_open(image_name)) == NULL))
+  {
+    fprintf(stderr, "error: image \"%s\" has not been published\n", image_name);
     return(EXIT_FAILURE);
   }
   if (argc == 1)
@@ -636,7 +4959,7 @@ int main(int argc, char * argv[])
     char buffer[1024];
     char* tokens[5];
     bool quits = false;
-    HashADT hashtable = ht_create(str_hash, str_equals, NULL, NULL);
+    HashADT hashtable = create_people_table();
     while (fgets(buffer, sizeof(buffer), stdin) != NULL)
     {
       char *token = strtok(buffer, " \t\n");
@@ -673,13 +4996,18 @@ int main(int argc, char * argv[])
     char buffer[1024];
     char* tokens[5];
     bool quits = false;
-    HashADT hashtable = ht_create(str_hash, str_equals, NULL, NULL);
+    HashADT hashtable = create_people_table();
     FILE* file = fopen( argv[1], "r" );
     if(file == NULL) 
     {
         perror(argv[1]);
         return(EXIT_FAILURE);
     }
+    else if(batch_mode == true)
+    {
+      run_batched_file(&hashtable, file);
+      fclose(file);
+    }
     else
     {
       while (fgets(buffer, sizeof(buffer), file) != NULL)
@@ -735,4 +5063,5 @@ int main(int argc, char * argv[])
     }
     quit(hashtable);
   }
-}
\ No newline at end of file
+}
+#endif
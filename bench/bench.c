@@ -0,0 +1,311 @@
+//author: Scott Bullock
+//Replays an amici command file and reports, as JSON on stdout, the overall
+//throughput, the latency percentiles of each command, the peak resident set
+//size and how often the people table rehashed. The output of the commands
+//themselves is thrown away. With -b the commands run through process_batch a
+//window at a time and each window is one "batch" sample. -t sets the number
+//of threads parallel loops use, to measure how batches scale.
+//
+//  gcc -O2 -DNDEBUG -o bench bench/bench.c HashADT.c intersect.c csr.c parallel.c trie.c varint.c histogram.c perfcount.c memtrack.c hugemem.c image.c -pthread
+//  ./bench [ -c ] [ -b ] [ -t threads ] graph.txt > result.json
+#define AMICI_NO_MAIN
+#include "../amici.c"
+#include <time.h>
+#include <sys/resource.h>
+
+//the most kinds of command the report keeps apart
+#define MAX_KINDS 32
+
+/// The latencies measured for one kind of command
+typedef struct kind_s {
+    char name[16];     //the command, lower case
+    uint64_t *samples;     //nanoseconds each run took
+    size_t count;     //number of samples
+    size_t capacity;     //length of samples
+    uint64_t total;     //sum of the samples
+} kind_t;
+
+//every kind of command seen so far
+static kind_t kinds[MAX_KINDS];
+//number of kinds in use
+static size_t kind_count = 0;
+
+/**
+Finds the kind of a command, adding it the first time it is seen. Commands
+past MAX_KINDS kinds are all counted as "other"
+@param command: the first word of the command
+@return the kind
+**/
+static kind_t* find_kind(const char* command)
+{
+  for(size_t i = 0; i < kind_count; i++)
+  {
+    if(strcasecmp(kinds[i].name, command) == 0)
+    {
+      return(&kinds[i]);
+    }
+  }
+  if(kind_count == MAX_KINDS - 1)
+  {
+    command = "other";
+    for(size_t i = 0; i < kind_count; i++)
+    {
+      if(strcmp(kinds[i].name, command) == 0)
+      {
+        return(&kinds[i]);
+      }
+    }
+  }
+  kind_t* kind = &kinds[kind_count];
+  kind_count+=1;
+  size_t i = 0;
+  for(; command[i] != '\0' && i < sizeof(kind->name) - 1; i++)
+  {
+    kind->name[i] = (char)tolower((unsigned char)command[i]);
+  }
+  kind->name[i] = '\0';
+  return(kind);
+}
+
+/**
+Records how long a command took
+@param kind: the kind of the command
+@param nanoseconds: the time it took
+**/
+static void add_sample(kind_t* kind, uint64_t nanoseconds)
+{
+  if(kind->count == kind->capacity)
+  {
+    kind->capacity = kind->capacity == 0 ? 1024 : kind->capacity * 2;
+    kind->samples = realloc(kind->samples, sizeof(uint64_t) * kind->capacity);
+    assert(kind->samples != NULL);
+  }
+  kind->samples[kind->count] = nanoseconds;
+  kind->count+=1;
+  kind->total+=nanoseconds;
+}
+
+/**
+Compares two samples for qsort
+@param sample1: pointer to one sample
+@param sample2: pointer to the other sample
+@return negative, zero or positive as sample1 is less, equal or greater
+**/
+static int compare_samples(const void *sample1, const void *sample2)
+{
+  uint64_t a = *(const uint64_t*)sample1;
+  uint64_t b = *(const uint64_t*)sample2;
+  return((a > b) - (a < b));
+}
+
+/**
+Gets a percentile of sorted samples by nearest rank
+@param kind: the kind, with its samples sorted
+@param fraction: the percentile as a fraction, 0.99 for p99
+@return the sample at that rank
+**/
+static uint64_t percentile(const kind_t* kind, double fraction)
+{
+  double position = fraction * (double)kind->count;
+  size_t rank = (size_t)position;
+  if((double)rank == position && rank > 0)
+  {
+    rank-=1;
+  }
+  if(rank >= kind->count)
+  {
+    rank = kind->count - 1;
+  }
+  return(kind->samples[rank]);
+}
+
+/**
+Gets the monotonic clock in nanoseconds
+@return the time
+**/
+static uint64_t now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return((uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec);
+}
+
+/**
+Reads a whole file into memory so reading it is not part of the timings
+@param path: the file
+@param length: set to the number of bytes read
+@return the contents, NUL terminated, or NULL if the file cannot be read
+**/
+static char* read_file(const char* path, size_t* length)
+{
+  FILE* file = fopen(path, "r");
+  if(file == NULL)
+  {
+    return(NULL);
+  }
+  size_t capacity = 1 << 16;
+  char* contents = malloc(capacity);
+  assert(contents != NULL);
+  *length = 0;
+  size_t got;
+  while((got = fread(contents + *length, 1, capacity - *length - 1, file)) > 0)
+  {
+    *length+=got;
+    if(capacity - *length - 1 == 0)
+    {
+      capacity*=2;
+      contents = realloc(contents, capacity);
+      assert(contents != NULL);
+    }
+  }
+  contents[*length] = '\0';
+  fclose(file);
+  return(contents);
+}
+
+/**
+Replays a command file and writes the report
+@param argc the number of args
+@param argv an optional -c for compressed friends, an optional -b for batch
+            mode and an optional -t with the number of threads, in any
+            order, then the command file
+**/
+int main(int argc, char * argv[])
+{
+  int option;
+  while((option = getopt(argc, argv, "cbt:")) != -1)
+  {
+    switch(option)
+    {
+      case 'c':
+        compressed_adjacency = true;
+        break;
+      case 'b':
+        batch_mode = true;
+        break;
+      case 't':
+        parallel_use_threads((unsigned)strtoul(optarg, NULL, 10));
+        break;
+      default:
+        fprintf(stderr, "usage: bench [ -c ] [ -b ] [ -t threads ] commands\n");
+        return(EXIT_FAILURE);
+    }
+  }
+  argc-=optind - 1;
+  argv+=optind - 1;
+  if(argc != 2)
+  {
+    fprintf(stderr, "usage: bench [ -c ] [ -b ] [ -t threads ] commands\n");
+    return(EXIT_FAILURE);
+  }
+  size_t length;
+  char* contents = read_file(argv[1], &length);
+  if(contents == NULL)
+  {
+    perror(argv[1]);
+    return(EXIT_FAILURE);
+  }
+  // the report goes to the real stdout, everything amici prints is dropped
+  fflush(stdout);
+  FILE* report = fdopen(dup(STDOUT_FILENO), "w");
+  if(report == NULL || freopen("/dev/null", "w", stdout) == NULL)
+  {
+    perror("stdout");
+    return(EXIT_FAILURE);
+  }
+  HashADT hashtable = create_people_table();
+  char* (*window)[5] = malloc(sizeof(*window) * BATCH_WINDOW);
+  assert(window != NULL);
+  size_t waiting = 0;
+  size_t commands = 0;
+  uint64_t started = now();
+  char* line = contents;
+  while(line < contents + length)
+  {
+    char* end = strchr(line, '\n');
+    if(end == NULL)
+    {
+      end = contents + length;
+    }
+    *end = '\0';
+    char* tokens[5] = {NULL, NULL, NULL, NULL, NULL};
+    int index_counter = 0;
+    for(char* token = strtok(line, " \t\r"); token != NULL; token = strtok(NULL, " \t\r"))
+    {
+      if(index_counter < 5)
+      {
+        tokens[index_counter] = token;
+      }
+      index_counter+=1;
+    }
+    line = end + 1;
+    if(tokens[0] == NULL || strcasecmp(tokens[0], "quit") == 0)
+    {
+      continue;
+    }
+    commands+=1;
+    if(batch_mode == true)
+    {
+      memcpy(window[waiting], tokens, sizeof(tokens));
+      waiting+=1;
+      if(waiting == BATCH_WINDOW)
+      {
+        uint64_t before = now();
+        process_batch(&hashtable, window, waiting, true);
+        add_sample(find_kind("batch"), now() - before);
+        waiting = 0;
+      }
+      continue;
+    }
+    kind_t* kind = find_kind(tokens[0]);
+    uint64_t before = now();
+    process_command(&hashtable, tokens, true);
+    add_sample(kind, now() - before);
+  }
+  if(waiting > 0)
+  {
+    uint64_t before = now();
+    process_batch(&hashtable, window, waiting, true);
+    add_sample(find_kind("batch"), now() - before);
+  }
+  free(window);
+  uint64_t elapsed = now() - started;
+  size_t rehashes = ht_rehashes(hashtable);
+  size_t people = size_of_hashtable;
+  size_t friendships = total_friendships;
+  quit(hashtable);
+  fflush(stdout);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double seconds = (double)elapsed / 1e9;
+  fprintf(report, "{\n");
+  fprintf(report, "  \"file\": \"%s\",\n", argv[1]);
+  fprintf(report, "  \"compressed\": %s,\n", compressed_adjacency == true ? "true" : "false");
+  fprintf(report, "  \"batch\": %s,\n", batch_mode == true ? "true" : "false");
+  fprintf(report, "  \"threads\": %u,\n", parallel_threads());
+  fprintf(report, "  \"commands\": %zu,\n", commands);
+  fprintf(report, "  \"people\": %zu,\n", people);
+  fprintf(report, "  \"friendships\": %zu,\n", friendships);
+  fprintf(report, "  \"seconds\": %.6f,\n", seconds);
+  fprintf(report, "  \"ops_per_sec\": %.1f,\n", seconds > 0 ? (double)commands / seconds : 0.0);
+  fprintf(report, "  \"peak_rss_kb\": %ld,\n", usage.ru_maxrss);
+  fprintf(report, "  \"rehashes\": %zu,\n", rehashes);
+  fprintf(report, "  \"commands_by_kind\": {");
+  for(size_t i = 0; i < kind_count; i++)
+  {
+    kind_t* kind = &kinds[i];
+    qsort(kind->samples, kind->count, sizeof(uint64_t), compare_samples);
+    double kind_seconds = (double)kind->total / 1e9;
+    fprintf(report, "%s\n    \"%s\": {\"count\": %zu, \"ops_per_sec\": %.1f, "
+            "\"p50_ns\": %lu, \"p99_ns\": %lu, \"p999_ns\": %lu, \"max_ns\": %lu}",
+            i == 0 ? "" : ",", kind->name, kind->count,
+            kind_seconds > 0 ? (double)kind->count / kind_seconds : 0.0,
+            (unsigned long)percentile(kind, 0.50), (unsigned long)percentile(kind, 0.99),
+            (unsigned long)percentile(kind, 0.999), (unsigned long)kind->samples[kind->count - 1]);
+    free(kind->samples);
+  }
+  fprintf(report, "\n  }\n}\n");
+  fclose(report);
+  free(contents);
+  return(EXIT_SUCCESS);
+}
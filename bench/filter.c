@@ -0,0 +1,147 @@
+//author: Scott Bullock
+//Measures ht_has on handles that are in the table and on handles that are
+//not, with and without the key filter, at load factors up to LOAD_THRESHOLD.
+//Prints the results as JSON on stdout.
+//
+//  gcc -O2 -DNDEBUG -o filter bench/filter.c memtrack.c hugemem.c -pthread
+//  ./filter [ lookups ] > result.json
+#include "../HashADT.c"
+#include <string.h>
+#include <time.h>
+
+//table capacity the loads are measured at
+#define CAPACITY (1UL << 21)
+
+//lookups of each kind when none is given
+#define DEFAULT_LOOKUPS 1000000
+
+/// str_hash returns the djb2 hash of a C-string, as amici hashes handles
+/// @param element the c-string to hash
+/// @return the hash value of the c-string
+static size_t str_hash( const void *element ) {
+    const unsigned char *str = (const unsigned char *) element;
+    size_t hash = 5381;
+    for(; *str != '\0'; str++)
+    {
+      hash = hash * 33 + *str;
+    }
+    return hash;
+}
+
+/// str_equals compares the elements as two C-strings.
+/// @param element1 first c-string
+/// @param element2 second c-string
+/// @return true if the two strings are equal
+static bool str_equals( const void *element1, const void *element2 ) {
+    return strcmp((const char *)element1, (const char *)element2) == 0;
+}
+
+/**
+Gets the monotonic clock in nanoseconds
+@return the time
+**/
+static uint64_t now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return((uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec);
+}
+
+/**
+Makes handles like amici people have
+@param prefix: the first letter, so different prefixes never collide
+@param count: the number of handles
+@return the handles
+**/
+static char** make_handles(char prefix, size_t count)
+{
+  char** handles = malloc(sizeof(char*) * count);
+  assert(handles != NULL);
+  for(size_t i = 0; i < count; i++)
+  {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%c%zu", prefix, i);
+    handles[i] = strdup(buffer);
+    assert(handles[i] != NULL);
+  }
+  return(handles);
+}
+
+/**
+Times ht_has over handles picked in a fixed pseudo-random order
+@param t: the table
+@param handles: the handles to look up
+@param count: the number of handles
+@param lookups: the number of lookups
+@return nanoseconds per lookup
+**/
+static double time_lookups(HashADT t, char** handles, size_t count, size_t lookups)
+{
+  size_t found = 0;
+  size_t index = 0;
+  uint64_t start = now();
+  for(size_t i = 0; i < lookups; i++)
+  {
+    index = (index + 2654435761UL) % count;
+    found+=ht_has(t, handles[index]) == true ? 1 : 0;
+  }
+  uint64_t elapsed = now() - start;
+  // keep the lookups from being optimized away
+  if(found == SIZE_MAX)
+  {
+    printf("%zu\n", found);
+  }
+  return((double)elapsed / (double)lookups);
+}
+
+/**
+Fills tables to several loads and prints hit and miss costs with and
+without the filter
+@param argc the number of args
+@param argv optionally the number of lookups of each kind
+**/
+int main(int argc, char * argv[])
+{
+  size_t lookups = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_LOOKUPS;
+  const double loads[] = {0.40, 0.50, 0.60, 0.70, 0.74};
+  size_t most = (size_t)(CAPACITY * loads[4]);
+  char** present = make_handles('u', most);
+  char** absent = make_handles('x', most);
+  printf("{\n  \"capacity\": %lu,\n  \"lookups\": %zu,\n  \"loads\": [", CAPACITY, lookups);
+  for(size_t l = 0; l < sizeof(loads) / sizeof(loads[0]); l++)
+  {
+    size_t count = (size_t)(CAPACITY * loads[l]);
+    HashADT t = ht_create(str_hash, str_equals, NULL, NULL);
+    for(size_t i = 0; i < count; i++)
+    {
+      ht_put(t, present[i], present[i]);
+    }
+    assert(t->capacity == CAPACITY);
+    double hit_plain = time_lookups(t, present, count, lookups);
+    double miss_plain = time_lookups(t, absent, count, lookups);
+    ht_use_filter(t, true);
+    double hit_filter = time_lookups(t, present, count, lookups);
+    double miss_filter = time_lookups(t, absent, count, lookups);
+    size_t passed = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+      passed+=filter_has(t, str_hash(absent[i])) == true ? 1 : 0;
+    }
+    printf("%s\n    {\"load\": %.3f, \"keys\": %zu, \"filter_bytes\": %zu, "
+           "\"hit_ns\": %.1f, \"miss_ns\": %.1f, \"hit_filter_ns\": %.1f, \"miss_filter_ns\": %.1f, "
+           "\"false_positive_rate\": %.5f}",
+           l == 0 ? "" : ",", (double)count / (double)t->capacity, count,
+           t->filter_blocks * FILTER_WORDS * sizeof(uint64_t),
+           hit_plain, miss_plain, hit_filter, miss_filter, (double)passed / (double)count);
+    ht_destroy(t);
+  }
+  printf("\n  ]\n}\n");
+  for(size_t i = 0; i < most; i++)
+  {
+    free(present[i]);
+    free(absent[i]);
+  }
+  free(present);
+  free(absent);
+  return(EXIT_SUCCESS);
+}
@@ -0,0 +1,213 @@
+//author: Scott Bullock
+//Writes an amici command file for a social graph grown by preferential
+//attachment, followed by a mix of queries and changes to replay against it.
+//
+//  gcc -O2 -o gen bench/gen.c
+//  ./gen people [ degree ] [ queries ] [ seed ] > graph.txt
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+//friendships each new person makes when no degree is given
+#define DEFAULT_DEGREE 4
+
+//the state of the random number generator
+static uint64_t random_state = 88172645463325252ULL;
+
+/**
+Gets the next number of a xorshift64 generator
+@return a random 64 bit number
+**/
+static uint64_t next_random(void)
+{
+  random_state^=random_state << 13;
+  random_state^=random_state >> 7;
+  random_state^=random_state << 17;
+  return(random_state);
+}
+
+/**
+Gets a random number below a bound
+@param bound: one past the largest number wanted
+@return a number in [0, bound)
+**/
+static size_t random_below(size_t bound)
+{
+  return((size_t)(next_random() % bound));
+}
+
+/**
+Writes the handle of a person
+@param person: the number of the person
+**/
+static void print_handle(size_t person)
+{
+  printf("u%zu", person);
+}
+
+/**
+Writes an alphabetic first name for a person, the number of the person
+written in base 26 with letters, so names share prefixes the way real ones do
+@param person: the number of the person
+**/
+static void print_first_name(size_t person)
+{
+  char name[16];
+  size_t length = 0;
+  do
+  {
+    name[length] = (char)('a' + person % 26);
+    person/=26;
+    length+=1;
+  } while(person > 0);
+  name[length - 1] = (char)(name[length - 1] - 'a' + 'A');
+  for(size_t i = length; i > 0; i--)
+  {
+    putchar(name[i - 1]);
+  }
+}
+
+/**
+Writes a command naming two people
+@param command: the command
+@param person1: the number of one person
+@param person2: the number of the other person
+**/
+static void print_pair(const char* command, size_t person1, size_t person2)
+{
+  printf("%s ", command);
+  print_handle(person1);
+  putchar(' ');
+  print_handle(person2);
+  putchar('\n');
+}
+
+/**
+Writes the commands: every person, every friendship, then the queries
+@param argc the number of args
+@param argv people, then optionally degree, queries and seed
+**/
+int main(int argc, char * argv[])
+{
+  if(argc < 2 || argc > 5)
+  {
+    fprintf(stderr, "usage: gen people [ degree ] [ queries ] [ seed ]\n");
+    return(EXIT_FAILURE);
+  }
+  size_t people = strtoul(argv[1], NULL, 10);
+  size_t degree = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_DEGREE;
+  size_t queries = argc > 3 ? strtoul(argv[3], NULL, 10) : people;
+  if(argc > 4)
+  {
+    random_state = strtoull(argv[4], NULL, 10) * 2654435761ULL + 1;
+  }
+  if(people < 2 || degree == 0 || degree >= people)
+  {
+    fprintf(stderr, "error: need at least 2 people and 0 < degree < people\n");
+    return(EXIT_FAILURE);
+  }
+  for(size_t i = 0; i < people; i++)
+  {
+    printf("add ");
+    print_first_name(i);
+    printf(" Bench ");
+    print_handle(i);
+    putchar('\n');
+  }
+  // every friendship adds both people to ends, so picking a random entry
+  // picks a person with probability proportional to their degree
+  size_t* ends = malloc(sizeof(size_t) * 2 * degree * people);
+  size_t* chosen = malloc(sizeof(size_t) * degree);
+  assert(ends != NULL && chosen != NULL);
+  size_t end_count = 0;
+  for(size_t i = 0; i <= degree; i++)
+  {
+    for(size_t j = 0; j < i; j++)
+    {
+      print_pair("friend", i, j);
+      ends[end_count] = i;
+      ends[end_count + 1] = j;
+      end_count+=2;
+    }
+  }
+  for(size_t i = degree + 1; i < people; i++)
+  {
+    size_t picked = 0;
+    while(picked < degree)
+    {
+      size_t target = ends[random_below(end_count)];
+      bool repeat = false;
+      for(size_t j = 0; j < picked; j++)
+      {
+        if(chosen[j] == target)
+        {
+          repeat = true;
+          break;
+        }
+      }
+      if(repeat == false)
+      {
+        chosen[picked] = target;
+        picked+=1;
+      }
+    }
+    for(size_t j = 0; j < degree; j++)
+    {
+      print_pair("friend", i, chosen[j]);
+      ends[end_count] = i;
+      ends[end_count + 1] = chosen[j];
+      end_count+=2;
+    }
+  }
+  // queries lean on the reads, with some churn so caches get invalidated
+  for(size_t i = 0; i < queries; i++)
+  {
+    size_t person1 = ends[random_below(end_count)];
+    size_t person2 = random_below(people);
+    size_t kind = random_below(100);
+    if(kind < 30)
+    {
+      printf("print ");
+      print_handle(person1);
+      putchar('\n');
+    }
+    else if(kind < 45)
+    {
+      printf("size ");
+      print_handle(person1);
+      putchar('\n');
+    }
+    else if(kind < 50)
+    {
+      printf("stats\n");
+    }
+    else if(kind < 65)
+    {
+      print_pair("mutual", person1, person2);
+    }
+    else if(kind < 72)
+    {
+      printf("suggest ");
+      print_handle(person1);
+      printf(" 5\n");
+    }
+    else if(kind < 80)
+    {
+      print_pair("path", person1, person2);
+    }
+    else if(kind < 90)
+    {
+      print_pair("friend", person1, person2);
+    }
+    else
+    {
+      print_pair("unfriend", person1, person2);
+    }
+  }
+  free(ends);
+  free(chosen);
+  return(EXIT_SUCCESS);
+}
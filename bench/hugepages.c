@@ -0,0 +1,189 @@
+//author: Scott Bullock
+//Measures random ht_get lookups on a table whose slot arrays are far larger
+//than the TLB covers with 4 KiB pages, with the arrays on ordinary pages or
+//on huge pages. Prints the results as JSON on stdout.
+//
+//  gcc -O2 -DNDEBUG -o hugepages bench/hugepages.c HashADT.c memtrack.c hugemem.c -pthread
+//  ./hugepages [ -H thp | hugetlb ] [ -I ] [ keys ] [ lookups ] > result.json
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "../HashADT.h"
+#include "../memtrack.h"
+
+//keys in the table when none is given, enough for two 128 MiB slot arrays
+#define DEFAULT_KEYS (6UL << 20)
+
+//lookups when none is given
+#define DEFAULT_LOOKUPS 20000000UL
+
+//the state of the random number generator
+static uint64_t random_state = 88172645463325252ULL;
+
+/**
+Gets the next number of a xorshift64 generator
+@return a random 64 bit number
+**/
+static uint64_t next_random(void)
+{
+  random_state^=random_state << 13;
+  random_state^=random_state >> 7;
+  random_state^=random_state << 17;
+  return(random_state);
+}
+
+/// key_hash mixes the bits of an integer key, so neighbouring keys land in
+/// slots far apart
+/// @param key the key, an integer stored in the pointer
+/// @return the hash value
+static size_t key_hash( const void *key ) {
+    uint64_t hash = (uint64_t)(uintptr_t)key;
+    hash^=hash >> 33;
+    hash*=0xff51afd7ed558ccdULL;
+    hash^=hash >> 33;
+    return (size_t)hash;
+}
+
+/// key_equals compares two integer keys
+/// @param key1 first key
+/// @param key2 second key
+/// @return true if the keys are equal
+static bool key_equals( const void *key1, const void *key2 ) {
+    return key1 == key2;
+}
+
+/// key_print is never called, ht_dump is not used here
+/// @param key the key
+/// @param value the value
+static void key_print( const void *key, const void *value ) {
+    (void)key;
+    (void)value;
+}
+
+/**
+Gets the monotonic clock in nanoseconds
+@return the time
+**/
+static uint64_t now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return((uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec);
+}
+
+/**
+Gets the anonymous memory of the process the kernel backs with huge pages
+@return the bytes, 0 if the kernel does not report them
+**/
+static size_t anon_huge_bytes(void)
+{
+  FILE* file = fopen("/proc/self/smaps_rollup", "r");
+  if(file == NULL)
+  {
+    return(0);
+  }
+  char line[256];
+  size_t kilobytes = 0;
+  while(fgets(line, sizeof(line), file) != NULL)
+  {
+    if(sscanf(line, "AnonHugePages: %zu kB", &kilobytes) == 1)
+    {
+      break;
+    }
+  }
+  fclose(file);
+  return(kilobytes * 1024);
+}
+
+/**
+Fills a table and times random lookups in it
+@param argc the number of args
+@param argv optionally -H and where huge pages come from, -I, the number of
+            keys and the number of lookups
+**/
+int main(int argc, char * argv[])
+{
+  const char* pages_name = "none";
+  huge_pages_t pages = HUGE_THP;
+  bool huge_pages = false;
+  if(argc > 2 && strcmp(argv[1], "-H") == 0)
+  {
+    if(strcmp(argv[2], "thp") != 0 && strcmp(argv[2], "hugetlb") != 0)
+    {
+      fprintf(stderr, "usage: hugepages [ -H thp | hugetlb ] [ -I ] [ keys ] [ lookups ]\n");
+      return(EXIT_FAILURE);
+    }
+    pages_name = argv[2];
+    pages = strcmp(argv[2], "hugetlb") == 0 ? HUGE_HUGETLB : HUGE_THP;
+    huge_pages = true;
+    argc-=2;
+    argv+=2;
+  }
+  bool interleave = false;
+  if(argc > 1 && strcmp(argv[1], "-I") == 0)
+  {
+    interleave = true;
+    if(huge_pages == false)
+    {
+      pages_name = "thp";
+      huge_pages = true;
+    }
+    argc-=1;
+    argv+=1;
+  }
+  if(argc > 3)
+  {
+    fprintf(stderr, "usage: hugepages [ -H thp | hugetlb ] [ -I ] [ keys ] [ lookups ]\n");
+    return(EXIT_FAILURE);
+  }
+  size_t keys = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_KEYS;
+  size_t lookups = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_LOOKUPS;
+  if(keys == 0)
+  {
+    fprintf(stderr, "error: need at least one key\n");
+    return(EXIT_FAILURE);
+  }
+  if(huge_pages == true && mem_use_huge_pages(MEM_TABLE, pages, interleave) == false)
+  {
+    fprintf(stderr, "error: huge pages cannot be set up\n");
+    return(EXIT_FAILURE);
+  }
+  HashADT table = ht_create(key_hash, key_equals, key_print, NULL);
+  uint64_t started = now();
+  for(size_t i = 0; i < keys; i++)
+  {
+    ht_put(table, (void*)(uintptr_t)(i + 1), (void*)(uintptr_t)i);
+  }
+  uint64_t filled = now();
+  // the keys are looked up in random order, every one a likely TLB miss
+  size_t found = 0;
+  uint64_t before = now();
+  for(size_t i = 0; i < lookups; i++)
+  {
+    const void* key = (const void*)(uintptr_t)(next_random() % keys + 1);
+    found+=(size_t)(uintptr_t)ht_get(table, key) + 1 == (size_t)(uintptr_t)key;
+  }
+  uint64_t elapsed = now() - before;
+  assert(found == lookups);
+  size_t mapped = 0;
+  size_t fallback = 0;
+  huge_stats(&mapped, &fallback);
+  printf("{\n");
+  printf("  \"pages\": \"%s\",\n", pages_name);
+  printf("  \"interleave\": %s,\n", interleave == true ? "true" : "false");
+  printf("  \"keys\": %zu,\n", keys);
+  printf("  \"lookups\": %zu,\n", lookups);
+  printf("  \"table_bytes\": %zu,\n", mem_reserved(MEM_TABLE));
+  printf("  \"fill_seconds\": %.3f,\n", (double)(filled - started) / 1e9);
+  printf("  \"ns_per_lookup\": %.1f,\n", (double)elapsed / (double)lookups);
+  printf("  \"arena_mapped_bytes\": %zu,\n", mapped);
+  printf("  \"arena_fallback_bytes\": %zu,\n", fallback);
+  printf("  \"anon_huge_bytes\": %zu\n", anon_huge_bytes());
+  printf("}\n");
+  ht_destroy(table);
+  return(EXIT_SUCCESS);
+}
@@ -0,0 +1,219 @@
+//author: Scott Bullock
+#include <stdlib.h>
+#include <assert.h>
+#include "csr.h"
+#include "intersect.h"
+#include "parallel.h"
+
+/// Vertices handed to a triangle counting worker at a time
+#define TRIANGLE_CHUNK 256
+
+/// Vertices handed to a PageRank worker at a time
+#define PAGERANK_CHUNK 1024
+
+/// The arguments of the triangle counting loop
+typedef struct triangle_count_s {
+    const csr_t *forward;     // the oriented graph
+    uint64_t found[MAX_THREADS];     // triangles found by each worker
+} triangle_count_t;
+
+/// The arguments of the PageRank loops
+typedef struct pagerank_s {
+    const csr_t *graph;     // the graph
+    double *rank;     // the rank of each vertex from the last iteration
+    double *next;     // the rank of each vertex being computed
+    double *share;     // rank / degree of each vertex from the last iteration
+    double base;     // rank every vertex gets without following an edge
+    double damping;     // the probability of following an edge
+    double dangling[MAX_THREADS];     // rank of isolated vertices per worker
+    double change[MAX_THREADS];     // total change per worker
+} pagerank_t;
+
+csr_t *csr_create( size_t vertices, size_t edges )
+{
+  csr_t *graph = (csr_t *)malloc(sizeof(csr_t));
+  assert(graph != NULL);
+  graph->vertices = vertices;
+  graph->edges = edges;
+  graph->offsets = calloc(vertices + 1, sizeof(size_t));
+  graph->targets = malloc(sizeof(uint32_t) * (edges + 1));
+  assert(graph->offsets != NULL && graph->targets != NULL);
+  return(graph);
+}
+
+void csr_destroy( csr_t *graph )
+{
+  if(graph == NULL)
+  {
+    return;
+  }
+  free(graph->offsets);
+  free(graph->targets);
+  free(graph);
+}
+
+/**
+Counts the triangles closed by the edges of a range of vertices
+@param first: the first vertex of the range
+@param last: one past the last vertex of the range
+@param arg: the triangle_count_t of the loop
+@param worker: the number of the worker running the range
+**/
+static void count_range(size_t first, size_t last, void *arg, unsigned worker)
+{
+  triangle_count_t *count = (triangle_count_t *)arg;
+  const csr_t *graph = count->forward;
+  uint64_t found = 0;
+  for(size_t v = first; v < last; v++)
+  {
+    const uint32_t *v_list = graph->targets + graph->offsets[v];
+    size_t v_length = graph->offsets[v + 1] - graph->offsets[v];
+    for(size_t i = 0; i < v_length; i++)
+    {
+      uint32_t u = v_list[i];
+      const uint32_t *u_list = graph->targets + graph->offsets[u];
+      size_t u_length = graph->offsets[u + 1] - graph->offsets[u];
+      // the common neighbors come after u in v's list, skip the rest
+      found+=intersect_sorted(v_list + i + 1, v_length - i - 1, u_list, u_length, NULL);
+    }
+  }
+  count->found[worker]+=found;
+}
+
+uint64_t csr_count_triangles( const csr_t *forward )
+{
+  triangle_count_t *count = calloc(1, sizeof(triangle_count_t));
+  assert(count != NULL);
+  count->forward = forward;
+  parallel_for(forward->vertices, TRIANGLE_CHUNK, count_range, count);
+  uint64_t total = 0;
+  for(unsigned i = 0; i < MAX_THREADS; i++)
+  {
+    total+=count->found[i];
+  }
+  free(count);
+  return(total);
+}
+
+/**
+Splits the rank of a range of vertices evenly over their edges, collecting
+the rank of vertices with no edges
+@param first: the first vertex of the range
+@param last: one past the last vertex of the range
+@param arg: the pagerank_t of the loop
+@param worker: the number of the worker running the range
+**/
+static void share_range(size_t first, size_t last, void *arg, unsigned worker)
+{
+  pagerank_t *pagerank = (pagerank_t *)arg;
+  const csr_t *graph = pagerank->graph;
+  double dangling = 0.0;
+  for(size_t v = first; v < last; v++)
+  {
+    size_t degree = graph->offsets[v + 1] - graph->offsets[v];
+    if(degree == 0)
+    {
+      dangling+=pagerank->rank[v];
+      pagerank->share[v] = 0.0;
+    }
+    else
+    {
+      pagerank->share[v] = pagerank->rank[v] / (double)degree;
+    }
+  }
+  pagerank->dangling[worker]+=dangling;
+}
+
+/**
+Pulls the shared rank of their neighbors into a range of vertices
+@param first: the first vertex of the range
+@param last: one past the last vertex of the range
+@param arg: the pagerank_t of the loop
+@param worker: the number of the worker running the range
+**/
+static void pull_range(size_t first, size_t last, void *arg, unsigned worker)
+{
+  pagerank_t *pagerank = (pagerank_t *)arg;
+  const csr_t *graph = pagerank->graph;
+  double change = 0.0;
+  for(size_t v = first; v < last; v++)
+  {
+    double sum = 0.0;
+    for(size_t i = graph->offsets[v]; i < graph->offsets[v + 1]; i++)
+    {
+      sum+=pagerank->share[graph->targets[i]];
+    }
+    double value = pagerank->base + pagerank->damping * sum;
+    change+=value > pagerank->rank[v] ? value - pagerank->rank[v] : pagerank->rank[v] - value;
+    pagerank->next[v] = value;
+  }
+  pagerank->change[worker]+=change;
+}
+
+size_t csr_pagerank( const csr_t *graph, double damping, double tolerance,
+                     size_t max_iterations, double *rank )
+{
+  size_t vertices = graph->vertices;
+  if(vertices == 0)
+  {
+    return(0);
+  }
+  pagerank_t *pagerank = calloc(1, sizeof(pagerank_t));
+  assert(pagerank != NULL);
+  pagerank->graph = graph;
+  pagerank->rank = rank;
+  pagerank->next = malloc(sizeof(double) * vertices);
+  pagerank->share = malloc(sizeof(double) * vertices);
+  assert(pagerank->next != NULL && pagerank->share != NULL);
+  pagerank->damping = damping;
+  for(size_t v = 0; v < vertices; v++)
+  {
+    rank[v] = 1.0 / (double)vertices;
+  }
+  size_t iteration = 0;
+  while(iteration < max_iterations)
+  {
+    for(unsigned i = 0; i < MAX_THREADS; i++)
+    {
+      pagerank->dangling[i] = 0.0;
+      pagerank->change[i] = 0.0;
+    }
+    parallel_for(vertices, PAGERANK_CHUNK, share_range, pagerank);
+    double dangling = 0.0;
+    for(unsigned i = 0; i < MAX_THREADS; i++)
+    {
+      dangling+=pagerank->dangling[i];
+    }
+    pagerank->base = (1.0 - damping + damping * dangling) / (double)vertices;
+    parallel_for(vertices, PAGERANK_CHUNK, pull_range, pagerank);
+    double change = 0.0;
+    for(unsigned i = 0; i < MAX_THREADS; i++)
+    {
+      change+=pagerank->change[i];
+    }
+    double *swap = pagerank->rank;
+    pagerank->rank = pagerank->next;
+    pagerank->next = swap;
+    iteration+=1;
+    if(change < tolerance)
+    {
+      break;
+    }
+  }
+  // the last ranks may sit in the scratch array after an odd number of swaps
+  if(pagerank->rank != rank)
+  {
+    for(size_t v = 0; v < vertices; v++)
+    {
+      rank[v] = pagerank->rank[v];
+    }
+    free(pagerank->rank);
+  }
+  else
+  {
+    free(pagerank->next);
+  }
+  free(pagerank->share);
+  free(pagerank);
+  return(iteration);
+}
@@ -0,0 +1,75 @@
+/// \file csr.h
+/// \brief A read-only graph in compressed sparse row form.
+///
+//author: Scott Bullock
+
+#ifndef CSR_H
+#define CSR_H
+
+#include <stddef.h>     // size_t
+#include <stdint.h>     // uint32_t, uint64_t
+
+///
+/// The neighbors of vertex v are targets[offsets[v]] up to (not including)
+/// targets[offsets[v + 1]], in increasing order.  The client fills in
+/// offsets and targets after creating the graph.
+///
+typedef struct csr_s {
+    size_t vertices;     // number of vertices
+    size_t edges;     // number of entries in targets
+    size_t *offsets;     // vertices + 1 starting positions into targets
+    uint32_t *targets;     // neighbor lists, one after the other
+} csr_t;
+
+///
+/// Create a graph with room for the given number of vertices and edges.
+///
+/// @param vertices The number of vertices
+/// @param edges The number of entries in the neighbor lists
+///
+/// @exception Assert fails if it cannot allocate space
+///
+/// @return A newly created graph with offsets and targets to fill in
+///
+csr_t *csr_create( size_t vertices, size_t edges );
+
+///
+/// Destroy the graph.
+///
+/// @param graph The graph to destroy
+///
+void csr_destroy( csr_t *graph );
+
+///
+/// Count the triangles of an undirected graph stored oriented: every edge
+/// appears once, in the list of whichever end comes first in degree order.
+/// Vertices are split across parallel_for workers and each edge is counted
+/// with intersect_sorted.
+///
+/// @param forward The oriented graph
+///
+/// @return The number of triangles
+///
+uint64_t csr_count_triangles( const csr_t *forward );
+
+///
+/// Compute PageRank over an undirected graph, each edge stored in the lists
+/// of both of its ends.  Every iteration pulls rank along the edges into
+/// each vertex, split across parallel_for workers, until the total change
+/// across all vertices falls below the tolerance.  The rank of vertices
+/// with no neighbors is spread evenly over the graph.
+///
+/// @param graph The graph
+/// @param damping The probability of following an edge, usually 0.85
+/// @param tolerance The total change at which the ranks are converged
+/// @param max_iterations The most iterations to run before giving up
+/// @param rank Receives the rank of each vertex, which sum to 1
+///
+/// @pre rank has room for graph->vertices values.
+///
+/// @return The number of iterations run
+///
+size_t csr_pagerank( const csr_t *graph, double damping, double tolerance,
+                     size_t max_iterations, double *rank );
+
+#endif // CSR_H
@@ -0,0 +1,62 @@
+//author: Scott Bullock
+#include <stddef.h>
+#include "histogram.h"
+
+/// Values below this are counted exactly
+#define EXACT_LIMIT (1ULL << HISTOGRAM_SUB_BITS)
+
+void histogram_record( histogram_t *histogram, uint64_t value )
+{
+  size_t index = (size_t)value;
+  if(value >= EXACT_LIMIT)
+  {
+    // the leading bit picks the power of two, the bits after it the bucket
+    unsigned exponent = 63 - (unsigned)__builtin_clzll(value);
+    unsigned shift = exponent - HISTOGRAM_SUB_BITS;
+    index = ((size_t)(shift + 1) << HISTOGRAM_SUB_BITS) + (size_t)((value >> shift) & (EXACT_LIMIT - 1));
+  }
+  histogram->buckets[index]+=1;
+  histogram->count+=1;
+  histogram->total+=value;
+  if(value > histogram->max)
+  {
+    histogram->max = value;
+  }
+}
+
+uint64_t histogram_percentile( const histogram_t *histogram, double fraction )
+{
+  if(histogram->count == 0)
+  {
+    return(0);
+  }
+  // nearest rank: the smallest value with at least that fraction at or below it
+  double position = fraction * (double)histogram->count;
+  uint64_t rank = (uint64_t)position;
+  if((double)rank == position && rank > 0)
+  {
+    rank-=1;
+  }
+  if(rank >= histogram->count)
+  {
+    rank = histogram->count - 1;
+  }
+  uint64_t seen = 0;
+  size_t index = 0;
+  for(; index < HISTOGRAM_BUCKETS; index++)
+  {
+    seen+=histogram->buckets[index];
+    if(seen > rank)
+    {
+      break;
+    }
+  }
+  uint64_t top = index;
+  if(index >= EXACT_LIMIT)
+  {
+    unsigned shift = (unsigned)(index >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t low = (EXACT_LIMIT + (index & (EXACT_LIMIT - 1))) << shift;
+    top = low + ((1ULL << shift) - 1);
+  }
+  return(top < histogram->max ? top : histogram->max);
+}
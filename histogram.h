@@ -0,0 +1,50 @@
+/// \file histogram.h
+/// \brief Log-bucketed histograms of 64-bit values such as latencies.
+///
+//author: Scott Bullock
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>     // uint64_t
+
+/// Each power of two is split into 2^HISTOGRAM_SUB_BITS buckets, so a
+/// recorded value is known to within 1/16 of itself
+#define HISTOGRAM_SUB_BITS 4
+
+/// Values below 2^HISTOGRAM_SUB_BITS get a bucket each, then every power
+/// of two up to 2^63 gets 2^HISTOGRAM_SUB_BITS
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+///
+/// A histogram is ready to use once it is zeroed, a static one needs no
+/// setup and memset clears one.
+///
+typedef struct histogram_s {
+    uint64_t count;     // number of values recorded
+    uint64_t total;     // sum of the values
+    uint64_t max;     // the largest value
+    uint64_t buckets[HISTOGRAM_BUCKETS];     // number of values per bucket
+} histogram_t;
+
+///
+/// Record a value in a histogram.
+///
+/// @param histogram The histogram
+/// @param value The value
+///
+void histogram_record( histogram_t *histogram, uint64_t value );
+
+///
+/// Get the value a given fraction of the recorded values are at or below.
+/// The answer is the top of the bucket holding that rank, but never more
+/// than the largest value recorded.
+///
+/// @param histogram The histogram
+/// @param fraction The percentile as a fraction, 0.99 for p99
+///
+/// @return The value, or 0 if nothing was recorded
+///
+uint64_t histogram_percentile( const histogram_t *histogram, double fraction );
+
+#endif // HISTOGRAM_H
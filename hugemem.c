@@ -0,0 +1,348 @@
+//author: Scott Bullock
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "hugemem.h"
+
+//the smallest block, a cache line
+#define MIN_BLOCK 64
+
+//block sizes, from MIN_BLOCK doubling up to half a page
+#define SIZE_CLASSES 15
+
+//the number of pages in the arena
+#define ARENA_PAGES (HUGE_RESERVE / HUGE_PAGE_SIZE)
+
+//set in the page_kinds entry of the first page of a large block, the rest
+//of the entry is the number of pages in the block
+#define LARGE_BLOCK 0x80000000U
+
+//asks mmap for pages of 2 MiB from the hugetlbfs pool
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+//NUMA policy values from numaif.h, which only comes with libnuma
+#define MPOL_INTERLEAVE 3
+#define MPOL_F_MEMS_ALLOWED (1 << 2)
+
+//the most NUMA nodes pages are interleaved over
+#define MAX_NODES 1024
+
+/// A run of free pages
+typedef struct run_s {
+    size_t first;     //the first page
+    size_t count;     //the number of pages
+} run_t;
+
+//the start of the arena, aligned to a page, NULL until huge_init
+static char *arena = NULL;
+//where the pages come from
+static huge_pages_t arena_pages;
+//true to spread the pages over node_mask
+static bool arena_interleave = false;
+//the NUMA nodes the process may use
+static unsigned long node_mask[MAX_NODES / (8 * sizeof(unsigned long))];
+//pages mapped so far, all of them below this page
+static size_t mapped_pages = 0;
+//pages that had to use THP instead of the hugetlbfs pool
+static size_t fallback_pages = 0;
+//what each page holds: 0 when free, a size class + 1 when cut into blocks,
+//or LARGE_BLOCK and a page count for the first page of a large block
+static uint32_t *page_kinds = NULL;
+//the first free block of each size class, linked through the blocks
+static void *free_blocks[SIZE_CLASSES];
+//runs of free mapped pages, sorted by first page, neighbours merged
+static run_t *free_runs = NULL;
+//the number of runs in free_runs
+static size_t run_count = 0;
+//the current length of free_runs
+static size_t run_capacity = 0;
+//held while the arena is changed
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+Gets the size class of a block
+@param size: the bytes wanted, at most half a page
+@return the class, whose blocks are MIN_BLOCK << class bytes
+**/
+static size_t size_class(size_t size)
+{
+  size_t class = 0;
+  while((size_t)(MIN_BLOCK << class) < size)
+  {
+    class+=1;
+  }
+  return(class);
+}
+
+/**
+Maps new pages in the reserved address space, on huge pages where it can
+@param first: the first page
+@param count: the number of pages
+@return false if the pages cannot be mapped
+**/
+static bool map_pages(size_t first, size_t count)
+{
+  char *start = arena + first * HUGE_PAGE_SIZE;
+  size_t bytes = count * HUGE_PAGE_SIZE;
+  void *mapped = MAP_FAILED;
+  if(arena_pages == HUGE_HUGETLB)
+  {
+    mapped = mmap(start, bytes, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+    if(mapped == MAP_FAILED)
+    {
+      fallback_pages+=count;
+    }
+  }
+  if(mapped == MAP_FAILED)
+  {
+    mapped = mmap(start, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if(mapped == MAP_FAILED)
+    {
+      return(false);
+    }
+    madvise(start, bytes, MADV_HUGEPAGE);
+  }
+  // nothing has touched the pages yet, so the policy decides where they go
+  if(arena_interleave == true)
+  {
+    syscall(SYS_mbind, start, bytes, MPOL_INTERLEAVE, node_mask, (unsigned long)MAX_NODES, 0U);
+  }
+  return(true);
+}
+
+/**
+Takes pages for a block, reusing freed ones first, with arena_lock held
+@param count: the number of pages
+@param first: receives the first page
+@return false if the arena is full or the pages cannot be mapped
+**/
+static bool take_pages(size_t count, size_t *first)
+{
+  for(size_t i = 0; i < run_count; i++)
+  {
+    if(free_runs[i].count >= count)
+    {
+      *first = free_runs[i].first;
+      free_runs[i].first+=count;
+      free_runs[i].count-=count;
+      if(free_runs[i].count == 0)
+      {
+        memmove(&free_runs[i], &free_runs[i + 1], sizeof(run_t) * (run_count - i - 1));
+        run_count-=1;
+      }
+      return(true);
+    }
+  }
+  if(count > ARENA_PAGES - mapped_pages || map_pages(mapped_pages, count) == false)
+  {
+    return(false);
+  }
+  *first = mapped_pages;
+  mapped_pages+=count;
+  return(true);
+}
+
+/**
+Gives back the pages of a large block, merging them with free neighbours,
+with arena_lock held
+@param first: the first page
+@param count: the number of pages
+**/
+static void give_pages(size_t first, size_t count)
+{
+  size_t at = 0;
+  while(at < run_count && free_runs[at].first < first)
+  {
+    at+=1;
+  }
+  if(at > 0 && free_runs[at - 1].first + free_runs[at - 1].count == first)
+  {
+    free_runs[at - 1].count+=count;
+    if(at < run_count && first + count == free_runs[at].first)
+    {
+      free_runs[at - 1].count+=free_runs[at].count;
+      memmove(&free_runs[at], &free_runs[at + 1], sizeof(run_t) * (run_count - at - 1));
+      run_count-=1;
+    }
+    return;
+  }
+  if(at < run_count && first + count == free_runs[at].first)
+  {
+    free_runs[at].first = first;
+    free_runs[at].count+=count;
+    return;
+  }
+  if(run_count == run_capacity)
+  {
+    size_t capacity = run_capacity == 0 ? 16 : run_capacity * 2;
+    run_t *runs = realloc(free_runs, sizeof(run_t) * capacity);
+    if(runs == NULL)
+    {
+      // the pages are lost to the arena, but stay mapped and harmless
+      return;
+    }
+    free_runs = runs;
+    run_capacity = capacity;
+  }
+  memmove(&free_runs[at + 1], &free_runs[at], sizeof(run_t) * (run_count - at));
+  free_runs[at].first = first;
+  free_runs[at].count = count;
+  run_count+=1;
+}
+
+bool huge_init( huge_pages_t pages, bool interleave )
+{
+  pthread_mutex_lock(&arena_lock);
+  if(arena != NULL)
+  {
+    pthread_mutex_unlock(&arena_lock);
+    return(true);
+  }
+  // one extra page so the start can be moved up to a page boundary
+  void *reserved = mmap(NULL, HUGE_RESERVE + HUGE_PAGE_SIZE, PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if(reserved == MAP_FAILED)
+  {
+    pthread_mutex_unlock(&arena_lock);
+    return(false);
+  }
+  page_kinds = calloc(ARENA_PAGES, sizeof(uint32_t));
+  if(page_kinds == NULL)
+  {
+    munmap(reserved, HUGE_RESERVE + HUGE_PAGE_SIZE);
+    pthread_mutex_unlock(&arena_lock);
+    return(false);
+  }
+  arena_pages = pages;
+  arena_interleave = interleave;
+  if(interleave == true &&
+     syscall(SYS_get_mempolicy, NULL, node_mask, (unsigned long)MAX_NODES, NULL, MPOL_F_MEMS_ALLOWED) != 0)
+  {
+    // a kernel without NUMA support, every page is local anyway
+    arena_interleave = false;
+  }
+  arena = (char *)(((uintptr_t)reserved + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+  pthread_mutex_unlock(&arena_lock);
+  return(true);
+}
+
+bool huge_owns( const void *block )
+{
+  const char *address = (const char *)block;
+  return(arena != NULL && address >= arena && address < arena + HUGE_RESERVE);
+}
+
+void *huge_alloc( size_t size )
+{
+  void *block = NULL;
+  pthread_mutex_lock(&arena_lock);
+  if(size <= HUGE_PAGE_SIZE / 2)
+  {
+    size_t class = size_class(size);
+    size_t page;
+    if(free_blocks[class] == NULL && take_pages(1, &page) == true)
+    {
+      page_kinds[page] = (uint32_t)class + 1;
+      size_t block_size = (size_t)MIN_BLOCK << class;
+      char *start = arena + page * HUGE_PAGE_SIZE;
+      // pushed from the top so blocks are handed out in address order
+      for(size_t offset = HUGE_PAGE_SIZE; offset > 0; offset-=block_size)
+      {
+        *(void **)(start + offset - block_size) = free_blocks[class];
+        free_blocks[class] = start + offset - block_size;
+      }
+    }
+    if(free_blocks[class] != NULL)
+    {
+      block = free_blocks[class];
+      free_blocks[class] = *(void **)block;
+    }
+  }
+  else
+  {
+    size_t count = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+    size_t first;
+    if(count < LARGE_BLOCK && take_pages(count, &first) == true)
+    {
+      page_kinds[first] = LARGE_BLOCK | (uint32_t)count;
+      block = arena + first * HUGE_PAGE_SIZE;
+    }
+  }
+  pthread_mutex_unlock(&arena_lock);
+  return(block);
+}
+
+void *huge_realloc( void *block, size_t size )
+{
+  if(block == NULL)
+  {
+    return(huge_alloc(size));
+  }
+  size_t old_size = huge_size(block);
+  if(size <= old_size)
+  {
+    return(block);
+  }
+  void *moved = huge_alloc(size);
+  if(moved == NULL)
+  {
+    return(NULL);
+  }
+  memcpy(moved, block, old_size);
+  huge_free(block);
+  return(moved);
+}
+
+void huge_free( void *block )
+{
+  if(block == NULL)
+  {
+    return;
+  }
+  size_t page = (size_t)((char *)block - arena) / HUGE_PAGE_SIZE;
+  pthread_mutex_lock(&arena_lock);
+  uint32_t kind = page_kinds[page];
+  if((kind & LARGE_BLOCK) != 0)
+  {
+    page_kinds[page] = 0;
+    give_pages(page, kind & ~LARGE_BLOCK);
+  }
+  else
+  {
+    *(void **)block = free_blocks[kind - 1];
+    free_blocks[kind - 1] = block;
+  }
+  pthread_mutex_unlock(&arena_lock);
+}
+
+size_t huge_size( const void *block )
+{
+  // the kind of a page only changes while none of its blocks are live
+  uint32_t kind = page_kinds[(size_t)((const char *)block - arena) / HUGE_PAGE_SIZE];
+  if((kind & LARGE_BLOCK) != 0)
+  {
+    return((size_t)(kind & ~LARGE_BLOCK) * HUGE_PAGE_SIZE);
+  }
+  return((size_t)MIN_BLOCK << (kind - 1));
+}
+
+bool huge_stats( size_t *mapped, size_t *fallback )
+{
+  if(arena == NULL)
+  {
+    return(false);
+  }
+  pthread_mutex_lock(&arena_lock);
+  *mapped = mapped_pages * HUGE_PAGE_SIZE;
+  *fallback = fallback_pages * HUGE_PAGE_SIZE;
+  pthread_mutex_unlock(&arena_lock);
+  return(true);
+}
@@ -0,0 +1,115 @@
+/// \file hugemem.h
+/// \brief An allocator that serves blocks from 2 MiB huge pages.
+///
+//author: Scott Bullock
+
+#ifndef HUGEMEM_H
+#define HUGEMEM_H
+
+#include <stdbool.h>    // bool
+#include <stddef.h>     // size_t
+
+/// The size of a huge page, the unit the arena maps memory in
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+/// The address space the arena reserves when it is set up
+#define HUGE_RESERVE ((size_t)64 << 30)
+
+///
+/// Where the huge pages come from.
+///
+typedef enum {
+    HUGE_THP,     // transparent huge pages, asked for with madvise
+    HUGE_HUGETLB     // the hugetlbfs pool, falling back to THP when it runs dry
+} huge_pages_t;
+
+///
+/// General Notes on the arena
+///
+/// - The arena reserves HUGE_RESERVE bytes of address space once and maps
+///   2 MiB pages inside it as they are needed.  Every page is aligned to its
+///   size, so the kernel can back it with a single huge page and one TLB
+///   entry covers all of it.
+///
+/// - A block of up to half a page comes from a page cut into blocks of one
+///   power of two size, at least 64 bytes, so it is aligned to that size.
+///   A larger block gets whole pages of its own.  Freed memory is kept for
+///   later blocks rather than given back to the kernel.
+///
+/// - With interleave, the pages are spread over the NUMA nodes the process
+///   may use.  Otherwise a page is placed on the node of the thread that
+///   first writes to it (first touch).
+///
+/// - Every function may be called from several threads at once.
+///
+
+///
+/// Set up the arena.  Only the first call does anything.
+///
+/// @param pages Where the huge pages come from
+/// @param interleave true to spread the pages over the NUMA nodes
+///
+/// @return false if the address space cannot be reserved
+///
+bool huge_init( huge_pages_t pages, bool interleave );
+
+///
+/// Tell whether a block came from the arena.
+///
+/// @param block Any pointer
+///
+/// @return true if it points into the arena
+///
+bool huge_owns( const void *block );
+
+///
+/// Allocate a block.
+///
+/// @param size The number of bytes
+///
+/// @return The block, or NULL if it cannot be allocated
+///
+/// @pre huge_init has succeeded.
+///
+void *huge_alloc( size_t size );
+
+///
+/// Resize a block, keeping its contents up to the smaller size.
+///
+/// @param block The block, or NULL to allocate a new one
+/// @param size The new number of bytes
+///
+/// @return The block, or NULL if it cannot be allocated, leaving the old
+///         block as it was
+///
+void *huge_realloc( void *block, size_t size );
+
+///
+/// Free a block.
+///
+/// @param block The block, NULL does nothing
+///
+void huge_free( void *block );
+
+///
+/// Get the bytes set aside for a block, which is its size rounded up to
+/// the size of its blocks or to whole pages.
+///
+/// @param block The block
+///
+/// @return The usable size
+///
+size_t huge_size( const void *block );
+
+///
+/// Get how much memory the arena has mapped.
+///
+/// @param mapped Receives the bytes mapped
+/// @param fallback Receives the bytes that could not get pages from the
+///        hugetlbfs pool and use transparent huge pages instead
+///
+/// @return false if the arena has not been set up, leaving both untouched
+///
+bool huge_stats( size_t *mapped, size_t *fallback );
+
+#endif // HUGEMEM_H
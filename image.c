@@ -0,0 +1,283 @@
+//author: Scott Bullock
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "image.h"
+
+/// The control segment, holding the generation readers should map
+typedef struct control_s {
+    _Atomic uint64_t generation;     //newest published version, 0 for none
+} control_t;
+
+struct image_reader_s
+{
+  char name[IMAGE_NAME_MAX + 1];     //the name of the image
+  control_t *control;     //the control segment, mapped read-only
+  const image_header_t *image;     //the version mapped now, or NULL
+};
+
+/**
+Writes the shared memory name of the control segment or of one version
+@param out: receives the name
+@param name: the name of the image
+@param generation: the version, or 0 for the control segment
+**/
+static void segment_name(char out[IMAGE_NAME_MAX + 32], const char* name, uint64_t generation)
+{
+  if(generation == 0)
+  {
+    snprintf(out, IMAGE_NAME_MAX + 32, "/%s", name);
+  }
+  else
+  {
+    snprintf(out, IMAGE_NAME_MAX + 32, "/%s.%lu", name, (unsigned long)generation);
+  }
+}
+
+/**
+Maps the control segment of an image
+@param name: the name of the image
+@param create: true to create it if missing and map it for writing
+@return the control segment, or NULL if it cannot be opened
+**/
+static control_t* open_control(const char* name, bool create)
+{
+  char path[IMAGE_NAME_MAX + 32];
+  segment_name(path, name, 0);
+  int fd = shm_open(path, create == true ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if(fd == -1)
+  {
+    return(NULL);
+  }
+  struct stat info;
+  if(fstat(fd, &info) == -1 || ((size_t)info.st_size < sizeof(control_t) &&
+     (create == false || ftruncate(fd, sizeof(control_t)) == -1)))
+  {
+    close(fd);
+    return(NULL);
+  }
+  void* control = mmap(NULL, sizeof(control_t), create == true ? PROT_READ | PROT_WRITE : PROT_READ,
+                       MAP_SHARED, fd, 0);
+  close(fd);
+  return(control == MAP_FAILED ? NULL : (control_t*)control);
+}
+
+/**
+Removes the segment of a version that could not be published, and the
+control segment too if that version was the first, so a failed publish
+leaves nothing behind in shared memory
+@param name: the name of the image
+@param generation: the version that failed
+**/
+static void discard_version(const char* name, uint64_t generation)
+{
+  char path[IMAGE_NAME_MAX + 32];
+  segment_name(path, name, generation);
+  shm_unlink(path);
+  if(generation == 1)
+  {
+    segment_name(path, name, 0);
+    shm_unlink(path);
+  }
+}
+
+uint64_t image_hash( const char *handle )
+{
+  uint64_t hash = 5381;
+  for(const unsigned char *c = (const unsigned char *)handle; *c != '\0'; c++)
+  {
+    hash = hash * 33 + *c;
+  }
+  return(hash);
+}
+
+bool image_name_valid( const char *name )
+{
+  size_t length = strlen(name);
+  if(length == 0 || length > IMAGE_NAME_MAX)
+  {
+    return(false);
+  }
+  for(size_t i = 0; i < length; i++)
+  {
+    if(isalnum((unsigned char)name[i]) == 0)
+    {
+      return(false);
+    }
+  }
+  return(true);
+}
+
+image_header_t *image_begin( const char *name, size_t bytes )
+{
+  control_t* control = open_control(name, true);
+  if(control == NULL)
+  {
+    return(NULL);
+  }
+  uint64_t generation = atomic_load(&control->generation) + 1;
+  munmap(control, sizeof(control_t));
+  char path[IMAGE_NAME_MAX + 32];
+  segment_name(path, name, generation);
+  int fd = shm_open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fd == -1)
+  {
+    discard_version(name, generation);
+    return(NULL);
+  }
+  if(ftruncate(fd, (off_t)bytes) == -1)
+  {
+    close(fd);
+    discard_version(name, generation);
+    return(NULL);
+  }
+  void* image = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(image == MAP_FAILED)
+  {
+    discard_version(name, generation);
+    return(NULL);
+  }
+  image_header_t* header = (image_header_t*)image;
+  memset(header, 0, sizeof(image_header_t));
+  header->magic = IMAGE_MAGIC;
+  header->generation = generation;
+  header->bytes = bytes;
+  return(header);
+}
+
+bool image_publish( const char *name, image_header_t *image )
+{
+  control_t* control = open_control(name, true);
+  uint64_t generation = image->generation;
+  munmap(image, image->bytes);
+  if(control == NULL)
+  {
+    discard_version(name, generation);
+    return(false);
+  }
+  // release so a reader that sees the generation also sees the whole image
+  atomic_store_explicit(&control->generation, generation, memory_order_release);
+  munmap(control, sizeof(control_t));
+  if(generation > 1)
+  {
+    // readers still mapping the old version keep it until they move on
+    char path[IMAGE_NAME_MAX + 32];
+    segment_name(path, name, generation - 1);
+    shm_unlink(path);
+  }
+  return(true);
+}
+
+image_reader_t image_open( const char *name )
+{
+  control_t* control = open_control(name, false);
+  if(control == NULL)
+  {
+    return(NULL);
+  }
+  image_reader_t reader = malloc(sizeof(struct image_reader_s));
+  if(reader == NULL)
+  {
+    munmap(control, sizeof(control_t));
+    return(NULL);
+  }
+  strcpy(reader->name, name);
+  reader->control = control;
+  reader->image = NULL;
+  return(reader);
+}
+
+const image_header_t *image_current( image_reader_t reader )
+{
+  while(true)
+  {
+    uint64_t generation = atomic_load_explicit(&reader->control->generation, memory_order_acquire);
+    if(generation == 0 || (reader->image != NULL && reader->image->generation == generation))
+    {
+      return(reader->image);
+    }
+    char path[IMAGE_NAME_MAX + 32];
+    segment_name(path, reader->name, generation);
+    int fd = shm_open(path, O_RDONLY, 0);
+    if(fd == -1)
+    {
+      // a newer version replaced it while we looked, try that one
+      if(atomic_load_explicit(&reader->control->generation, memory_order_acquire) != generation)
+      {
+        continue;
+      }
+      return(reader->image);
+    }
+    struct stat info;
+    void* image = MAP_FAILED;
+    if(fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(image_header_t))
+    {
+      image = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(image == MAP_FAILED)
+    {
+      return(reader->image);
+    }
+    const image_header_t* header = (const image_header_t*)image;
+    if(header->magic != IMAGE_MAGIC || header->bytes != (uint64_t)info.st_size)
+    {
+      munmap(image, (size_t)info.st_size);
+      return(reader->image);
+    }
+    if(reader->image != NULL)
+    {
+      munmap((void*)reader->image, reader->image->bytes);
+    }
+    reader->image = header;
+    return(header);
+  }
+}
+
+void image_close( image_reader_t reader )
+{
+  if(reader->image != NULL)
+  {
+    munmap((void*)reader->image, reader->image->bytes);
+  }
+  munmap(reader->control, sizeof(control_t));
+  free(reader);
+}
+
+const image_person_t *image_find( const image_header_t *image, const char *handle )
+{
+  const uint32_t* slots = (const uint32_t*)((const char*)image + image->slots);
+  uint64_t mask = image->slot_count - 1;
+  for(uint64_t slot = image_hash(handle) & mask; slots[slot] != 0; slot = (slot + 1) & mask)
+  {
+    const image_person_t* person = image_person(image, slots[slot] - 1);
+    if(strcmp(image_string(image, person->handle), handle) == 0)
+    {
+      return(person);
+    }
+  }
+  return(NULL);
+}
+
+const char *image_string( const image_header_t *image, uint64_t offset )
+{
+  return((const char*)image + image->strings + offset);
+}
+
+const uint32_t *image_friends( const image_header_t *image, const image_person_t *person )
+{
+  return((const uint32_t*)((const char*)image + image->friends) + person->first_friend);
+}
+
+const image_person_t *image_person( const image_header_t *image, uint32_t number )
+{
+  return((const image_person_t*)((const char*)image + image->persons) + number);
+}
@@ -0,0 +1,174 @@
+/// \file image.h
+/// \brief A read-only graph image shared between processes.
+///
+//author: Scott Bullock
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdbool.h>    // bool
+#include <stddef.h>     // size_t
+#include <stdint.h>     // uint32_t, uint64_t
+
+/// Marks the start of every image, "AMICIMG1" in memory order
+#define IMAGE_MAGIC 0x31474d4943494d41ULL
+
+/// The longest image name, not counting the NUL
+#define IMAGE_NAME_MAX 64
+
+///
+/// General Notes on images
+///
+/// - An image holds no pointers.  Everything in it is found by offsets from
+///   the start of the image, so any process can map it anywhere.
+///
+/// - The writer builds each version in a new shared memory segment named
+///   "/name.generation", then publishes it by storing the generation in
+///   the control segment "/name".  A published image is never written again.
+///
+/// - Readers check the control segment before each use and map the newest
+///   image when the generation changed.  A reader always sees one whole
+///   version, and an old version stays mapped until the reader moves on.
+///
+
+///
+/// The start of an image.  The other sections follow at the given offsets.
+///
+typedef struct image_header_s {
+    uint64_t magic;     // IMAGE_MAGIC
+    uint64_t generation;     // version of the image, counting from 1
+    uint64_t bytes;     // size of the whole image
+    uint64_t people;     // number of people
+    uint64_t friendships;     // number of friendships
+    uint64_t slot_count;     // number of hash slots, a power of two
+    uint64_t persons;     // offset of image_person_t[people]
+    uint64_t slots;     // offset of uint32_t[slot_count]; each a person + 1, 0 if empty
+    uint64_t friends;     // offset of the uint32_t friend lists, one after the other
+    uint64_t strings;     // offset of the NUL terminated names and handles
+} image_header_t;
+
+///
+/// A person in an image.  Friends are the numbers of other image people.
+///
+typedef struct image_person_s {
+    uint64_t handle;     // offset of the handle from the strings section
+    uint64_t name;     // offset of the name from the strings section
+    uint64_t first_friend;     // index of the first friend in the friends section
+    uint64_t friend_count;     // number of friends
+} image_person_t;
+
+///
+/// The reader side of a published image.  The structure is opaque.
+///
+typedef struct image_reader_s *image_reader_t;
+
+///
+/// Hash a handle the way image slots are laid out.
+///
+/// @param handle The handle
+///
+/// @return The hash value
+///
+uint64_t image_hash( const char *handle );
+
+///
+/// Tell whether a name can be used for an image: letters and digits only.
+///
+/// @param name The name
+///
+/// @return true if it is valid
+///
+bool image_name_valid( const char *name );
+
+///
+/// Create the shared memory segment of the next version of an image and
+/// map it for writing.  The header is zeroed but for magic, generation
+/// and bytes; the writer fills in the rest.
+///
+/// @param name The name of the image
+/// @param bytes The size of the whole image
+///
+/// @return The mapped image, or NULL if the segment cannot be created, in
+///         which case no new segment is left in shared memory
+///
+image_header_t *image_begin( const char *name, size_t bytes );
+
+///
+/// Publish an image filled in since image_begin, making readers switch to
+/// it, then unmap it and remove the segment of the version before it.
+///
+/// @param name The name of the image
+/// @param image The image from image_begin
+///
+/// @return false if the control segment cannot be opened, in which case
+///         the segment of the image is removed
+///
+bool image_publish( const char *name, image_header_t *image );
+
+///
+/// Start reading an image.
+///
+/// @param name The name of the image
+///
+/// @return The reader, or NULL if nothing was ever published under the name
+///
+image_reader_t image_open( const char *name );
+
+///
+/// Get the newest published version of an image, mapping it if it changed
+/// since the last call.
+///
+/// @param reader The reader
+///
+/// @return The image, or NULL if no version can be mapped
+///
+const image_header_t *image_current( image_reader_t reader );
+
+///
+/// Stop reading an image and unmap it.
+///
+/// @param reader The reader
+///
+void image_close( image_reader_t reader );
+
+///
+/// Find a person by handle.
+///
+/// @param image The image
+/// @param handle The handle
+///
+/// @return The person, or NULL if the handle is not in the image
+///
+const image_person_t *image_find( const image_header_t *image, const char *handle );
+
+///
+/// Get a string of an image.
+///
+/// @param image The image
+/// @param offset The offset from the strings section, as kept in a person
+///
+/// @return The string
+///
+const char *image_string( const image_header_t *image, uint64_t offset );
+
+///
+/// Get the friend list of a person.
+///
+/// @param image The image
+/// @param person The person
+///
+/// @return person->friend_count numbers of people
+///
+const uint32_t *image_friends( const image_header_t *image, const image_person_t *person );
+
+///
+/// Get a person by number.
+///
+/// @param image The image
+/// @param number The number of the person, as kept in friend lists
+///
+/// @return The person
+///
+const image_person_t *image_person( const image_header_t *image, uint32_t number );
+
+#endif // IMAGE_H
@@ -0,0 +1,162 @@
+//author: Scott Bullock
+#include <stdlib.h>
+#include <stdint.h>
+#include "intersect.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+Finds the first index in a sorted array at or after start whose value is not
+less than key, by doubling the step and then binary searching the last step
+@param set: the sorted set to search
+@param len: the number of ids in the set
+@param start: the index the search begins at
+@param key: the id to look for
+@return the index of the first id >= key, or len if there is none
+**/
+static size_t gallop(const uint32_t *set, size_t len, size_t start, uint32_t key)
+{
+  size_t low = start;
+  size_t step = 1;
+  size_t high = start;
+  while(high < len && set[high] < key)
+  {
+    low = high + 1;
+    high = start + step;
+    step*=2;
+  }
+  if(high > len)
+  {
+    high = len;
+  }
+  while(low < high)
+  {
+    size_t middle = low + (high - low) / 2;
+    if(set[middle] < key)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return(low);
+}
+
+/**
+Intersects a small set with a much larger one by galloping through the larger
+@return the number of common ids
+**/
+static size_t intersect_gallop(const uint32_t *small, size_t small_len,
+                               const uint32_t *large, size_t large_len, uint32_t *out)
+{
+  size_t count = 0;
+  size_t position = 0;
+  for(size_t i = 0; i < small_len && position < large_len; i++)
+  {
+    position = gallop(large, large_len, position, small[i]);
+    if(position < large_len && large[position] == small[i])
+    {
+      if(out != NULL)
+      {
+        out[count] = small[i];
+      }
+      count+=1;
+      position+=1;
+    }
+  }
+  return(count);
+}
+
+/**
+Intersects two sets of similar size with a merge, four ids at a time
+@return the number of common ids
+**/
+static size_t intersect_merge(const uint32_t *a, size_t a_len,
+                              const uint32_t *b, size_t b_len, uint32_t *out)
+{
+  size_t count = 0;
+  size_t i = 0;
+  size_t j = 0;
+#ifdef __SSE2__
+  // compare each block of a against all four rotations of the block of b,
+  // then drop whichever block ends first (both when they end on the same id)
+  while(i + 4 <= a_len && j + 4 <= b_len)
+  {
+    __m128i block_a = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i block_b = _mm_loadu_si128((const __m128i *)(b + j));
+    __m128i match = _mm_cmpeq_epi32(block_a, block_b);
+    match = _mm_or_si128(match, _mm_cmpeq_epi32(block_a, _mm_shuffle_epi32(block_b, _MM_SHUFFLE(0, 3, 2, 1))));
+    match = _mm_or_si128(match, _mm_cmpeq_epi32(block_a, _mm_shuffle_epi32(block_b, _MM_SHUFFLE(1, 0, 3, 2))));
+    match = _mm_or_si128(match, _mm_cmpeq_epi32(block_a, _mm_shuffle_epi32(block_b, _MM_SHUFFLE(2, 1, 0, 3))));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(match));
+    while(mask != 0)
+    {
+      int lane = __builtin_ctz(mask);
+      if(out != NULL)
+      {
+        out[count] = a[i + lane];
+      }
+      count+=1;
+      mask&=mask - 1;
+    }
+    uint32_t last_a = a[i + 3];
+    uint32_t last_b = b[j + 3];
+    if(last_a <= last_b)
+    {
+      i+=4;
+    }
+    if(last_b <= last_a)
+    {
+      j+=4;
+    }
+  }
+#endif
+  while(i < a_len && j < b_len)
+  {
+    if(a[i] < b[j])
+    {
+      i+=1;
+    }
+    else if(b[j] < a[i])
+    {
+      j+=1;
+    }
+    else
+    {
+      if(out != NULL)
+      {
+        out[count] = a[i];
+      }
+      count+=1;
+      i+=1;
+      j+=1;
+    }
+  }
+  return(count);
+}
+
+size_t intersect_sorted( const uint32_t *a, size_t a_len,
+                         const uint32_t *b, size_t b_len, uint32_t *out )
+{
+  if(a_len > b_len)
+  {
+    const uint32_t *swap = a;
+    a = b;
+    b = swap;
+    size_t swap_len = a_len;
+    a_len = b_len;
+    b_len = swap_len;
+  }
+  if(a_len == 0)
+  {
+    return(0);
+  }
+  if(a_len * GALLOP_RATIO < b_len)
+  {
+    return(intersect_gallop(a, a_len, b, b_len, out));
+  }
+  return(intersect_merge(a, a_len, b, b_len, out));
+}
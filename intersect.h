@@ -0,0 +1,34 @@
+/// \file intersect.h
+/// \brief Intersection of sorted sets of 32-bit ids.
+///
+//author: Scott Bullock
+
+#ifndef INTERSECT_H
+#define INTERSECT_H
+
+#include <stddef.h>     // size_t
+#include <stdint.h>     // uint32_t
+
+/// When one set is this many times larger than the other, the smaller set
+/// is galloped through the larger one instead of merging the two
+#define GALLOP_RATIO 32
+
+///
+/// Intersect two strictly increasing arrays of ids.  Sets of similar size
+/// are merged in blocks of four with SSE2 compares where available; very
+/// different sizes use galloping (exponential then binary) search.
+///
+/// @param a The first sorted set
+/// @param a_len The number of ids in a
+/// @param b The second sorted set
+/// @param b_len The number of ids in b
+/// @param out Receives the common ids in increasing order, or NULL to only count
+///
+/// @pre out has room for the smaller of a_len and b_len ids.
+///
+/// @return The number of common ids
+///
+size_t intersect_sorted( const uint32_t *a, size_t a_len,
+                         const uint32_t *b, size_t b_len, uint32_t *out );
+
+#endif // INTERSECT_H
@@ -0,0 +1,183 @@
+//author: Scott Bullock
+#define _DEFAULT_SOURCE
+#define _ISOC11_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "memtrack.h"
+#ifdef __linux__
+#include <malloc.h>
+#endif
+
+const char *mem_category_names[MEM_CATEGORIES] = {
+  "table", "people", "strings", "friends", "indexes"
+};
+
+//bytes held for each category, atomic since parallel workers allocate
+static atomic_size_t reserved_bytes[MEM_CATEGORIES];
+//live blocks of each category
+static atomic_size_t live_blocks[MEM_CATEGORIES];
+//categories whose new blocks come from the huge page arena
+static bool huge_category[MEM_CATEGORIES];
+
+/**
+Gets the bytes the allocator set aside for a block
+@param block: the block
+@return the usable size, 0 for NULL or where it cannot be asked
+**/
+static size_t block_size(void *block)
+{
+  if(block != NULL && huge_owns(block) == true)
+  {
+    return(huge_size(block));
+  }
+#ifdef __linux__
+  return(block == NULL ? 0 : malloc_usable_size(block));
+#else
+  (void)block;
+  return(0);
+#endif
+}
+
+/**
+Counts a new block against a category
+@param category: the category
+@param block: the block, NULL if the allocation failed
+@return the block
+**/
+static void *track(mem_category_t category, void *block)
+{
+  if(block != NULL)
+  {
+    reserved_bytes[category]+=block_size(block);
+    live_blocks[category]+=1;
+  }
+  return(block);
+}
+
+bool mem_use_huge_pages( mem_category_t category, huge_pages_t pages, bool interleave )
+{
+  if(huge_init(pages, interleave) == false)
+  {
+    return(false);
+  }
+  huge_category[category] = true;
+  return(true);
+}
+
+void *mem_malloc( mem_category_t category, size_t size )
+{
+  if(huge_category[category] == true)
+  {
+    return(track(category, huge_alloc(size)));
+  }
+  return(track(category, malloc(size)));
+}
+
+void *mem_calloc( mem_category_t category, size_t count, size_t size )
+{
+  if(huge_category[category] == true)
+  {
+    if(size != 0 && count > (size_t)-1 / size)
+    {
+      return(NULL);
+    }
+    // freed blocks are reused as they are, so they must be cleared
+    void *block = huge_alloc(count * size);
+    if(block != NULL)
+    {
+      memset(block, 0, count * size);
+    }
+    return(track(category, block));
+  }
+  return(track(category, calloc(count, size)));
+}
+
+void *mem_aligned( mem_category_t category, size_t alignment, size_t size )
+{
+  if(huge_category[category] == true)
+  {
+    // blocks are aligned to their size, up to a whole page
+    return(track(category, huge_alloc(size < alignment ? alignment : size)));
+  }
+  return(track(category, aligned_alloc(alignment, size)));
+}
+
+void *mem_realloc( mem_category_t category, void *block, size_t size )
+{
+  size_t old_size = block_size(block);
+  void *moved;
+  if(block == NULL ? huge_category[category] == true : huge_owns(block) == true)
+  {
+    moved = huge_realloc(block, size);
+  }
+  else
+  {
+    moved = realloc(block, size);
+  }
+  if(moved == NULL)
+  {
+    return(NULL);
+  }
+  if(block == NULL)
+  {
+    live_blocks[category]+=1;
+  }
+  reserved_bytes[category]+=block_size(moved) - old_size;
+  return(moved);
+}
+
+char *mem_strdup( mem_category_t category, const char *string )
+{
+  if(huge_category[category] == true)
+  {
+    size_t length = strlen(string) + 1;
+    char *copy = huge_alloc(length);
+    if(copy != NULL)
+    {
+      memcpy(copy, string, length);
+    }
+    return((char *)track(category, copy));
+  }
+  return((char *)track(category, strdup(string)));
+}
+
+void mem_free( mem_category_t category, void *block )
+{
+  if(block == NULL)
+  {
+    return;
+  }
+  reserved_bytes[category]-=block_size(block);
+  live_blocks[category]-=1;
+  if(huge_owns(block) == true)
+  {
+    huge_free(block);
+    return;
+  }
+  free(block);
+}
+
+size_t mem_reserved( mem_category_t category )
+{
+  return(reserved_bytes[category]);
+}
+
+size_t mem_blocks( mem_category_t category )
+{
+  return(live_blocks[category]);
+}
+
+bool mem_heap( size_t *allocated, size_t *unused )
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 info = mallinfo2();
+  *allocated = info.uordblks + info.hblkhd;
+  *unused = info.fordblks;
+  return(true);
+#else
+  (void)allocated;
+  (void)unused;
+  return(false);
+#endif
+}
@@ -0,0 +1,138 @@
+/// \file memtrack.h
+/// \brief Allocation wrappers that count the bytes held per category.
+///
+/// The counts are updated atomically, so the wrappers may be called from
+/// several threads at once.
+///
+//author: Scott Bullock
+
+#ifndef MEMTRACK_H
+#define MEMTRACK_H
+
+#include <stdbool.h>    // bool
+#include <stddef.h>     // size_t
+#include "hugemem.h"
+
+///
+/// What an allocation is for.  A block must be freed or reallocated with
+/// the category it was allocated with.
+///
+typedef enum {
+    MEM_TABLE,     // hashtable slot arrays
+    MEM_PEOPLE,     // the arrays of the person store
+    MEM_STRINGS,     // names and handles
+    MEM_FRIENDS,     // friend arrays and packed friend ids
+    MEM_INDEXES,     // id directory, groups, degree buckets and query caches
+    MEM_CATEGORIES     // the number of categories
+} mem_category_t;
+
+/// The names of the categories, for reports
+extern const char *mem_category_names[MEM_CATEGORIES];
+
+///
+/// Serve the new blocks of a category from the huge page arena.  Blocks
+/// allocated before the call stay where they are and are still freed
+/// correctly.
+///
+/// @param category The category
+/// @param pages Where the huge pages come from
+/// @param interleave true to spread the pages over the NUMA nodes, false to
+///        place each on the node of the thread that first touches it
+///
+/// @return false if the arena cannot be set up, leaving the category alone
+///
+bool mem_use_huge_pages( mem_category_t category, huge_pages_t pages, bool interleave );
+
+///
+/// malloc, counting the block against a category.
+///
+/// @param category What the block is for
+/// @param size The number of bytes
+///
+/// @return The block, or NULL if it cannot be allocated
+///
+void *mem_malloc( mem_category_t category, size_t size );
+
+///
+/// calloc, counting the block against a category.
+///
+/// @param category What the block is for
+/// @param count The number of elements
+/// @param size The size of each element
+///
+/// @return The zeroed block, or NULL if it cannot be allocated
+///
+void *mem_calloc( mem_category_t category, size_t count, size_t size );
+
+///
+/// aligned_alloc, counting the block against a category.
+///
+/// @param category What the block is for
+/// @param alignment The alignment, a power of two
+/// @param size The number of bytes, a multiple of alignment
+///
+/// @return The block, or NULL if it cannot be allocated
+///
+void *mem_aligned( mem_category_t category, size_t alignment, size_t size );
+
+///
+/// realloc, moving the count of the block along with it.
+///
+/// @param category What the block is for
+/// @param block The block, or NULL to allocate a new one
+/// @param size The new number of bytes
+///
+/// @return The block, or NULL if it cannot be allocated
+///
+void *mem_realloc( mem_category_t category, void *block, size_t size );
+
+///
+/// strdup, counting the copy against a category.
+///
+/// @param category What the copy is for
+/// @param string The string to copy
+///
+/// @return The copy, or NULL if it cannot be allocated
+///
+char *mem_strdup( mem_category_t category, const char *string );
+
+///
+/// free, taking the block off the count of its category.
+///
+/// @param category What the block was for
+/// @param block The block, NULL does nothing
+///
+void mem_free( mem_category_t category, void *block );
+
+///
+/// Get the bytes the allocator holds for a category, counting the rounding
+/// it adds to each block.  Only Linux reports block sizes, elsewhere this
+/// is always 0.
+///
+/// @param category The category
+///
+/// @return The bytes reserved
+///
+size_t mem_reserved( mem_category_t category );
+
+///
+/// Get the number of live blocks of a category.
+///
+/// @param category The category
+///
+/// @return The number of blocks
+///
+size_t mem_blocks( mem_category_t category );
+
+///
+/// Get how the whole heap splits between allocated blocks and free space
+/// the allocator keeps but cannot hand out in one piece.
+///
+/// @param allocated Receives the bytes in allocated blocks
+/// @param unused Receives the free bytes held in the heap
+///
+/// @return false if the C library cannot tell, leaving both untouched
+///
+bool mem_heap( size_t *allocated, size_t *unused );
+
+#endif // MEMTRACK_H
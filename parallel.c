@@ -0,0 +1,205 @@
+//author: Scott Bullock
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "parallel.h"
+
+/// The state shared by the workers of one parallel loop
+typedef struct loop_s {
+    atomic_size_t next;     //first index not yet handed out
+    size_t count;     //number of indexes in the loop
+    size_t chunk;     //number of indexes handed out at a time
+    void (*body)(size_t first, size_t last, void *arg, unsigned worker);
+    void *arg;     //passed through to body
+} loop_t;
+
+//the number of threads set by parallel_use_threads, 0 for every processor
+static unsigned thread_limit = 0;
+
+//the pool threads, pool_threads[i] is worker i + 1
+static pthread_t pool_threads[MAX_THREADS];
+//the number of pool threads running
+static unsigned pool_size = 0;
+//guards the pool state below
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+//signalled when a loop starts or the pool stops
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+//signalled when the last pool thread of a loop finishes its chunks
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+//the loop being run
+static loop_t *pool_loop = NULL;
+//bumped for each loop, so a waiting thread can tell a new one started
+static unsigned long pool_generation = 0;
+//the workers taking part in the loop, the caller included
+static unsigned pool_wanted = 0;
+//pool threads of the loop still running chunks
+static unsigned pool_busy = 0;
+//true while parallel_stop waits for the threads to exit
+static bool pool_stopping = false;
+//held by a loop from start to finish, so loops run one at a time
+static pthread_mutex_t loop_lock = PTHREAD_MUTEX_INITIALIZER;
+
+unsigned parallel_threads( void )
+{
+  if(thread_limit > 0)
+  {
+    return(thread_limit > MAX_THREADS ? MAX_THREADS : thread_limit);
+  }
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  if(online < 1)
+  {
+    return(1);
+  }
+  if(online > MAX_THREADS)
+  {
+    return(MAX_THREADS);
+  }
+  return((unsigned)online);
+}
+
+void parallel_use_threads( unsigned threads )
+{
+  thread_limit = threads;
+}
+
+size_t parallel_chunk( size_t count )
+{
+  size_t chunk = count / ((size_t)parallel_threads() * CHUNKS_PER_WORKER);
+  return(chunk > 0 ? chunk : 1);
+}
+
+/**
+Takes chunks of a loop until none are left
+@param loop: the loop
+@param worker: the number of the worker taking them
+**/
+static void run_chunks(loop_t *loop, unsigned worker)
+{
+  while(true)
+  {
+    size_t first = atomic_fetch_add(&loop->next, loop->chunk);
+    if(first >= loop->count)
+    {
+      break;
+    }
+    size_t last = first + loop->chunk;
+    if(last > loop->count)
+    {
+      last = loop->count;
+    }
+    loop->body(first, last, loop->arg, worker);
+  }
+}
+
+/**
+Waits for loops and runs its share of each, until the pool stops
+@param data: the number of the worker, stored in the pointer
+@return NULL
+**/
+static void *pool_worker(void *data)
+{
+  unsigned worker = (unsigned)(uintptr_t)data;
+  unsigned long seen = 0;
+  pthread_mutex_lock(&pool_lock);
+  while(true)
+  {
+    while(pool_generation == seen && pool_stopping == false)
+    {
+      pthread_cond_wait(&pool_wake, &pool_lock);
+    }
+    if(pool_stopping == true)
+    {
+      break;
+    }
+    seen = pool_generation;
+    if(worker >= pool_wanted)
+    {
+      // the loop is too small to need this thread
+      continue;
+    }
+    loop_t *loop = pool_loop;
+    pthread_mutex_unlock(&pool_lock);
+    run_chunks(loop, worker);
+    pthread_mutex_lock(&pool_lock);
+    pool_busy-=1;
+    if(pool_busy == 0)
+    {
+      pthread_cond_signal(&pool_done);
+    }
+  }
+  pthread_mutex_unlock(&pool_lock);
+  return(NULL);
+}
+
+void parallel_for( size_t count, size_t chunk,
+                   void (*body)( size_t first, size_t last, void *arg, unsigned worker ),
+                   void *arg )
+{
+  assert(chunk > 0);
+  loop_t loop;
+  atomic_init(&loop.next, 0);
+  loop.count = count;
+  loop.chunk = chunk;
+  loop.body = body;
+  loop.arg = arg;
+  unsigned threads = parallel_threads();
+  if((count + chunk - 1) / chunk < threads)
+  {
+    threads = (unsigned)((count + chunk - 1) / chunk);
+  }
+  if(threads <= 1)
+  {
+    run_chunks(&loop, 0);
+    return;
+  }
+  pthread_mutex_lock(&loop_lock);
+  pthread_mutex_lock(&pool_lock);
+  while(pool_size < threads - 1)
+  {
+    if(pthread_create(&pool_threads[pool_size], NULL, pool_worker, (void *)(uintptr_t)(pool_size + 1)) != 0)
+    {
+      // run with the threads started so far
+      threads = pool_size + 1;
+      break;
+    }
+    pool_size+=1;
+  }
+  pool_loop = &loop;
+  pool_wanted = threads;
+  pool_busy = threads - 1;
+  pool_generation+=1;
+  pthread_cond_broadcast(&pool_wake);
+  pthread_mutex_unlock(&pool_lock);
+  run_chunks(&loop, 0);
+  pthread_mutex_lock(&pool_lock);
+  while(pool_busy > 0)
+  {
+    pthread_cond_wait(&pool_done, &pool_lock);
+  }
+  pool_loop = NULL;
+  pthread_mutex_unlock(&pool_lock);
+  pthread_mutex_unlock(&loop_lock);
+}
+
+void parallel_stop( void )
+{
+  pthread_mutex_lock(&loop_lock);
+  pthread_mutex_lock(&pool_lock);
+  pool_stopping = true;
+  pthread_cond_broadcast(&pool_wake);
+  pthread_mutex_unlock(&pool_lock);
+  for(unsigned i = 0; i < pool_size; i++)
+  {
+    pthread_join(pool_threads[i], NULL);
+  }
+  pthread_mutex_lock(&pool_lock);
+  pool_size = 0;
+  pool_stopping = false;
+  pthread_mutex_unlock(&pool_lock);
+  pthread_mutex_unlock(&loop_lock);
+}
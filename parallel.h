@@ -0,0 +1,75 @@
+/// \file parallel.h
+/// \brief A parallel loop over a range of indexes.
+///
+/// The worker threads are started by the first loop that needs them and are
+/// kept waiting between loops, so a loop costs a wake up rather than a
+/// thread start.
+///
+//author: Scott Bullock
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>     // size_t
+
+/// Upper limit on the number of threads a parallel loop starts
+#define MAX_THREADS 64
+
+/// The number of chunks parallel_chunk aims to give each worker, so a slow
+/// chunk can be balanced by the others
+#define CHUNKS_PER_WORKER 4
+
+///
+/// Get the number of threads parallel loops will use, which is the number
+/// set by parallel_use_threads, or else the number of online processors,
+/// capped at MAX_THREADS.
+///
+/// @return The number of worker threads, at least 1
+///
+unsigned parallel_threads( void );
+
+///
+/// Set the number of threads parallel loops will use.
+///
+/// @param threads The number of threads, 0 for the number of online
+///        processors
+///
+void parallel_use_threads( unsigned threads );
+
+///
+/// Get a chunk size that splits a loop into about CHUNKS_PER_WORKER
+/// chunks for each worker.
+///
+/// @param count The number of indexes in the loop
+///
+/// @return The chunk size, at least 1
+///
+size_t parallel_chunk( size_t count );
+
+///
+/// Run body over [0, count) split into chunks of the given size.  Every
+/// worker thread takes the next unclaimed chunk when it finishes one, so
+/// chunks of uneven cost balance out across the threads.  The calling
+/// thread is worker 0; with a single chunk or a single worker the loop
+/// runs on the calling thread alone.  Loops started from different threads
+/// run one after the other.
+///
+/// @param count The number of indexes
+/// @param chunk The number of indexes handed out at a time
+/// @param body Called with each chunk [first, last), the arg and the
+///        number of the worker running it, below parallel_threads()
+/// @param arg Passed through to body
+///
+/// @pre chunk is greater than 0, and body does not call parallel_for.
+///
+void parallel_for( size_t count, size_t chunk,
+                   void (*body)( size_t first, size_t last, void *arg, unsigned worker ),
+                   void *arg );
+
+///
+/// Stop the worker threads and wait for them to exit.  A later loop
+/// starts them again.
+///
+void parallel_stop( void );
+
+#endif // PARALLEL_H
@@ -0,0 +1,137 @@
+//author: Scott Bullock
+#define _DEFAULT_SOURCE
+#include <string.h>
+#include <unistd.h>
+#include "perfcount.h"
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+const char *perf_counter_names[PERF_COUNTERS] = {
+  "cycles", "instructions", "llc_misses", "branch_misses"
+};
+
+//file descriptor of each counter, -1 when it is not running
+static int counter_fds[PERF_COUNTERS] = {-1, -1, -1, -1};
+//where each running counter comes in a group read
+static unsigned group_positions[PERF_COUNTERS];
+//the counter leading the group, -1 while nothing is open
+static int leader_fd = -1;
+//number of counters in the group
+static unsigned group_size = 0;
+//whether the counters also count the threads started after perf_start
+static bool threads_inherited = false;
+
+#ifdef __linux__
+//the generic hardware event behind each counter
+static const uint64_t counter_events[PERF_COUNTERS] = {
+  PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/**
+Opens one counter of the calling thread on whichever cpu it runs
+@param event: the hardware event
+@param group: the group leader, or -1 to lead a new group
+@param inherit: whether threads the calling thread starts later are counted too
+@return the file descriptor, or -1 if the counter is unavailable
+**/
+static int open_counter(uint64_t event, int group, bool inherit)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = event;
+  attr.disabled = group == -1 ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.inherit = inherit == true ? 1 : 0;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return((int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+#endif
+
+unsigned perf_start( void )
+{
+  if(leader_fd != -1)
+  {
+    return(group_size);
+  }
+#ifdef __linux__
+  // kernels older than 4.13 refuse inherited counters in a group read, so
+  // the first counter settles whether the group inherits
+  threads_inherited = true;
+  for(unsigned i = 0; i < PERF_COUNTERS; i++)
+  {
+    counter_fds[i] = open_counter(counter_events[i], leader_fd, threads_inherited);
+    if(counter_fds[i] == -1 && leader_fd == -1 && threads_inherited == true)
+    {
+      threads_inherited = false;
+      counter_fds[i] = open_counter(counter_events[i], leader_fd, false);
+    }
+    if(counter_fds[i] == -1)
+    {
+      continue;
+    }
+    if(leader_fd == -1)
+    {
+      leader_fd = counter_fds[i];
+    }
+    group_positions[i] = group_size;
+    group_size+=1;
+  }
+  if(leader_fd != -1)
+  {
+    ioctl(leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+#endif
+  return(group_size);
+}
+
+void perf_stop( void )
+{
+  for(unsigned i = 0; i < PERF_COUNTERS; i++)
+  {
+    if(counter_fds[i] != -1)
+    {
+      close(counter_fds[i]);
+      counter_fds[i] = -1;
+    }
+  }
+  leader_fd = -1;
+  group_size = 0;
+  threads_inherited = false;
+}
+
+bool perf_running( unsigned counter )
+{
+  return(counter_fds[counter] != -1);
+}
+
+bool perf_counts_threads( void )
+{
+  return(leader_fd != -1 && threads_inherited == true);
+}
+
+void perf_read( uint64_t values[PERF_COUNTERS] )
+{
+  // a group read gives the number of counters, then each count in the
+  // order they joined
+  uint64_t buffer[PERF_COUNTERS + 1];
+  memset(values, 0, sizeof(uint64_t) * PERF_COUNTERS);
+  if(leader_fd == -1 || read(leader_fd, buffer, sizeof(buffer)) < (ssize_t)sizeof(uint64_t))
+  {
+    return;
+  }
+  for(unsigned i = 0; i < PERF_COUNTERS; i++)
+  {
+    if(counter_fds[i] != -1 && group_positions[i] < buffer[0])
+    {
+      values[i] = buffer[1 + group_positions[i]];
+    }
+  }
+}
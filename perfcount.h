@@ -0,0 +1,64 @@
+/// \file perfcount.h
+/// \brief Hardware performance counters of the calling thread and the
+/// threads it starts.
+///
+//author: Scott Bullock
+
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+#include <stdbool.h>    // bool
+#include <stdint.h>     // uint64_t
+
+/// The number of counters kept: cycles, instructions, last level cache
+/// misses and branch misses, in that order
+#define PERF_COUNTERS 4
+
+/// The names of the counters, for reports
+extern const char *perf_counter_names[PERF_COUNTERS];
+
+///
+/// Open and start the counters, counting user-mode work of the calling
+/// thread and of every thread it starts afterwards, such as the workers of
+/// a parallel loop; threads already running are not counted.  Kernels that
+/// cannot inherit counters into a group count the calling thread only, see
+/// perf_counts_threads.  Counters the kernel or hardware refuses are left out,
+/// which happens in containers, virtual machines and when
+/// perf_event_paranoid forbids it.  Does nothing if already started.
+///
+/// @return The number of counters running, 0 if none are available
+///
+unsigned perf_start( void );
+
+///
+/// Stop and close the counters.
+///
+void perf_stop( void );
+
+///
+/// Tell whether a counter is running.
+///
+/// @param counter The counter, below PERF_COUNTERS
+///
+/// @return true if perf_start could open it
+///
+bool perf_running( unsigned counter );
+
+///
+/// Tell whether the running counters include the threads started after
+/// perf_start.
+///
+/// @return true if they do, false if they count the calling thread only or
+///         nothing is running
+///
+bool perf_counts_threads( void );
+
+///
+/// Read the counters with a single system call.
+///
+/// @param values Receives the count of each counter since perf_start,
+///        0 for counters that are not running
+///
+void perf_read( uint64_t values[PERF_COUNTERS] );
+
+#endif // PERFCOUNT_H
@@ -0,0 +1,229 @@
+//author: Scott Bullock
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+#include "trie.h"
+
+/// A node of the trie, reached by the characters of a word so far
+typedef struct trie_node_s {
+    struct trie_node_s **children;     //children in increasing key order
+    char *keys;     //the character leading to each child
+    size_t child_count;     //number of children
+    size_t child_capacity;     //current length of children and keys
+    uint32_t *values;     //values of the words ending at this node
+    size_t value_count;     //number of values
+    size_t value_capacity;     //current length of values
+} trie_node_t;
+
+struct trie_s
+{
+  trie_node_t *root;
+};
+
+/**
+Allocates an empty node
+@return the node
+**/
+static trie_node_t *create_node(void)
+{
+  trie_node_t *node = calloc(1, sizeof(trie_node_t));
+  assert(node != NULL);
+  return(node);
+}
+
+/**
+Frees a node and everything below it
+@param node: the node to free
+**/
+static void destroy_node(trie_node_t *node)
+{
+  for(size_t i = 0; i < node->child_count; i++)
+  {
+    destroy_node(node->children[i]);
+  }
+  free(node->children);
+  free(node->keys);
+  free(node->values);
+  free(node);
+}
+
+/**
+Finds where a key is, or belongs, among the children of a node
+@param node: the node
+@param key: the character to look for
+@return the index of the first child whose key is not less than key
+**/
+static size_t child_index(const trie_node_t *node, char key)
+{
+  size_t low = 0;
+  size_t high = node->child_count;
+  while(low < high)
+  {
+    size_t middle = (low + high) / 2;
+    if(node->keys[middle] < key)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return(low);
+}
+
+/**
+Follows the characters of a word down from a node
+@param node: the node to start from
+@param word: the characters to follow
+@return the node reached, or NULL if the word leaves the trie
+**/
+static trie_node_t *descend(trie_node_t *node, const char *word)
+{
+  for(const char *c = word; *c != '\0' && node != NULL; c++)
+  {
+    char key = (char)tolower((unsigned char)*c);
+    size_t index = child_index(node, key);
+    if(index < node->child_count && node->keys[index] == key)
+    {
+      node = node->children[index];
+    }
+    else
+    {
+      node = NULL;
+    }
+  }
+  return(node);
+}
+
+/**
+Collects the values of a node and its children, in key order
+@param node: the node to start from
+@param out: receives the values
+@param count: the number of values already in out
+@param limit: the most values out can hold
+@return the number of values in out afterward
+**/
+static size_t collect(const trie_node_t *node, uint32_t *out, size_t count, size_t limit)
+{
+  for(size_t i = 0; i < node->value_count && count < limit; i++)
+  {
+    out[count] = node->values[i];
+    count+=1;
+  }
+  for(size_t i = 0; i < node->child_count && count < limit; i++)
+  {
+    count = collect(node->children[i], out, count, limit);
+  }
+  return(count);
+}
+
+/**
+Removes one value stored under a word below a node, and frees the nodes the
+word leaves with no values and no children on the way back up
+@param node: the node to start from
+@param word: the characters still to follow
+@param value: the value to remove
+@return true if the value was stored under the word
+**/
+static bool remove_value(trie_node_t *node, const char *word, uint32_t value)
+{
+  if(*word == '\0')
+  {
+    for(size_t i = 0; i < node->value_count; i++)
+    {
+      if(node->values[i] == value)
+      {
+        // keep the remaining values in the order they were stored
+        memmove(node->values + i, node->values + i + 1, sizeof(uint32_t) * (node->value_count - i - 1));
+        node->value_count-=1;
+        return(true);
+      }
+    }
+    return(false);
+  }
+  char key = (char)tolower((unsigned char)*word);
+  size_t index = child_index(node, key);
+  if(index == node->child_count || node->keys[index] != key)
+  {
+    return(false);
+  }
+  trie_node_t *child = node->children[index];
+  if(remove_value(child, word + 1, value) == false)
+  {
+    return(false);
+  }
+  if(child->value_count == 0 && child->child_count == 0)
+  {
+    destroy_node(child);
+    memmove(node->children + index, node->children + index + 1, sizeof(trie_node_t *) * (node->child_count - index - 1));
+    memmove(node->keys + index, node->keys + index + 1, node->child_count - index - 1);
+    node->child_count-=1;
+  }
+  return(true);
+}
+
+TrieADT trie_create( void )
+{
+  TrieADT t = (TrieADT) malloc(sizeof(struct trie_s));
+  assert(t != NULL);
+  t->root = create_node();
+  return(t);
+}
+
+void trie_destroy( TrieADT t )
+{
+  assert(t != NULL);
+  destroy_node(t->root);
+  free(t);
+}
+
+void trie_insert( TrieADT t, const char *word, uint32_t value )
+{
+  trie_node_t *node = t->root;
+  for(const char *c = word; *c != '\0'; c++)
+  {
+    char key = (char)tolower((unsigned char)*c);
+    size_t index = child_index(node, key);
+    if(index == node->child_count || node->keys[index] != key)
+    {
+      if(node->child_count == node->child_capacity)
+      {
+        node->child_capacity = node->child_capacity == 0 ? 2 : node->child_capacity * 2;
+        node->children = realloc(node->children, sizeof(trie_node_t *) * node->child_capacity);
+        node->keys = realloc(node->keys, node->child_capacity);
+        assert(node->children != NULL && node->keys != NULL);
+      }
+      memmove(node->children + index + 1, node->children + index, sizeof(trie_node_t *) * (node->child_count - index));
+      memmove(node->keys + index + 1, node->keys + index, node->child_count - index);
+      node->children[index] = create_node();
+      node->keys[index] = key;
+      node->child_count+=1;
+    }
+    node = node->children[index];
+  }
+  if(node->value_count == node->value_capacity)
+  {
+    node->value_capacity = node->value_capacity == 0 ? 1 : node->value_capacity * 2;
+    node->values = realloc(node->values, sizeof(uint32_t) * node->value_capacity);
+    assert(node->values != NULL);
+  }
+  node->values[node->value_count] = value;
+  node->value_count+=1;
+}
+
+bool trie_remove( TrieADT t, const char *word, uint32_t value )
+{
+  return(remove_value(t->root, word, value));
+}
+
+size_t trie_find( const TrieADT t, const char *prefix, uint32_t *out, size_t limit )
+{
+  trie_node_t *node = descend(t->root, prefix);
+  if(node == NULL)
+  {
+    return(0);
+  }
+  return(collect(node, out, 0, limit));
+}
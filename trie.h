@@ -0,0 +1,86 @@
+/// \file trie.h
+/// \brief A case-insensitive prefix index from words to 32-bit values.
+///
+//author: Scott Bullock
+
+#ifndef TRIE_H
+#define TRIE_H
+
+#include <stdbool.h>    // bool
+#include <stddef.h>     // size_t
+#include <stdint.h>     // uint32_t
+
+///
+/// General Notes on trie Operation
+///
+/// - Words are compared without regard to case.  A word may be stored with
+///   any number of values, and a value with any number of words.
+///
+/// - Each node keeps its children in a small array sorted by character, so
+///   a lookup costs the length of the prefix plus the matches it returns,
+///   however many words are stored.
+///
+
+///
+/// The TrieADT data type is a pointer to an opaque structure; clients
+/// cannot see the structure's content.
+///
+typedef struct trie_s *TrieADT;
+
+///
+/// Create a new, empty trie.
+///
+/// @exception Assert fails if it cannot allocate space
+///
+/// @return A newly created trie
+///
+TrieADT trie_create( void );
+
+///
+/// Destroy the trie instance and all of its nodes.
+///
+/// @param t The trie to destroy
+///
+/// @post t is not a valid instance of trie.
+///
+void trie_destroy( TrieADT t );
+
+///
+/// Store a value under a word.
+///
+/// @param t The trie
+/// @param word The word
+/// @param value The value
+///
+/// @exception Assert fails if it cannot allocate space
+///
+void trie_insert( TrieADT t, const char *word, uint32_t value );
+
+///
+/// Remove one value stored under a word.  Nodes the word leaves with no
+/// values and no children are freed, so removed words cost nothing later.
+///
+/// @param t The trie
+/// @param word The word
+/// @param value The value
+///
+/// @return Whether the value was stored under the word
+///
+bool trie_remove( TrieADT t, const char *word, uint32_t value );
+
+///
+/// Get values whose words start with a prefix, in alphabetical order of
+/// their words.  A value stored under two matching words is returned twice.
+///
+/// @param t The trie
+/// @param prefix The prefix, an empty prefix matches every word
+/// @param out Receives the values
+/// @param limit The most values to return
+///
+/// @pre out has room for limit values.
+///
+/// @return The number of values stored in out
+///
+size_t trie_find( const TrieADT t, const char *prefix, uint32_t *out, size_t limit );
+
+#endif // TRIE_H
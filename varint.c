@@ -0,0 +1,49 @@
+//author: Scott Bullock
+#include <stdlib.h>
+#include "varint.h"
+
+size_t varint_encode( const uint32_t *ids, size_t count, uint8_t *out )
+{
+  size_t length = 0;
+  uint32_t previous = 0;
+  for(size_t i = 0; i < count; i++)
+  {
+    uint32_t gap = ids[i] - previous;
+    previous = ids[i];
+    while(gap >= 0x80)
+    {
+      out[length] = (uint8_t)(gap | 0x80);
+      gap>>=7;
+      length+=1;
+    }
+    out[length] = (uint8_t)gap;
+    length+=1;
+  }
+  return(length);
+}
+
+const uint8_t *varint_read( const uint8_t *in, uint32_t *gap )
+{
+  uint32_t value = *in & 0x7f;
+  int shift = 7;
+  while(*in & 0x80)
+  {
+    in+=1;
+    value|=(uint32_t)(*in & 0x7f) << shift;
+    shift+=7;
+  }
+  *gap = value;
+  return(in + 1);
+}
+
+void varint_decode( const uint8_t *in, size_t count, uint32_t *out )
+{
+  uint32_t previous = 0;
+  for(size_t i = 0; i < count; i++)
+  {
+    uint32_t gap;
+    in = varint_read(in, &gap);
+    previous+=gap;
+    out[i] = previous;
+  }
+}
@@ -0,0 +1,51 @@
+/// \file varint.h
+/// \brief Delta and variable-length byte coding of sorted 32-bit ids.
+///
+//author: Scott Bullock
+
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <stddef.h>     // size_t
+#include <stdint.h>     // uint8_t, uint32_t
+
+/// The most bytes one coded id can take
+#define VARINT_MAX_BYTES 5
+
+///
+/// Code a strictly increasing array of ids as the gap from each id to the
+/// one before it (the first id is its own gap), seven bits per byte with
+/// the high bit set on every byte but the last of a gap.
+///
+/// @param ids The ids to code
+/// @param count The number of ids
+/// @param out Receives the coded bytes
+///
+/// @pre out has room for count * VARINT_MAX_BYTES bytes.
+///
+/// @return The number of bytes written to out
+///
+size_t varint_encode( const uint32_t *ids, size_t count, uint8_t *out );
+
+///
+/// Read one coded gap.
+///
+/// @param in The first byte of the gap
+/// @param gap Receives the gap
+///
+/// @return The first byte after the gap
+///
+const uint8_t *varint_read( const uint8_t *in, uint32_t *gap );
+
+///
+/// Decode ids coded by varint_encode.
+///
+/// @param in The coded bytes
+/// @param count The number of ids coded
+/// @param out Receives the ids in increasing order
+///
+/// @pre out has room for count ids.
+///
+void varint_decode( const uint8_t *in, size_t count, uint32_t *out );
+
+#endif // VARINT_H